@@ -10,7 +10,8 @@
 
 //==============================================================================
 PurristAudioProcessorEditor::PurristAudioProcessorEditor (PurristAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p), buzzSection(p), hissSection(p), noiseSection(p)
+    : AudioProcessorEditor (&p), audioProcessor (p), buzzSection(p), hissSection(p), noiseSection(p),
+    diagnosticsOverlay(p)
 {
     PurristLookAndFeel* lnf = PurristLookAndFeel::getInstance();
     PurristHelpButtonLNF* hlnf = PurristHelpButtonLNF::getInstance();
@@ -51,6 +52,26 @@ PurristAudioProcessorEditor::PurristAudioProcessorEditor (PurristAudioProcessor&
     helpButton.setButtonText("?");
     helpButton.onClick = [this] { helpURL.launchInDefaultBrowser(); };
     
+    compareButtons[0].setButtonText("A");
+    compareButtons[0].setConnectedEdges(juce::TextButton::ConnectedOnRight);
+    
+    compareButtons[1].setButtonText("B");
+    compareButtons[1].setConnectedEdges(juce::TextButton::ConnectedOnLeft | juce::TextButton::ConnectedOnRight);
+    
+    copyButton.setButtonText("Copy");
+    copyButton.setConnectedEdges(juce::TextButton::ConnectedOnLeft);
+    copyButton.onClick = [this] { audioProcessor.getPresetManager().copyToOtherSlot(); };
+    
+    for (int i = 0; i < 2; i++) {
+        compareButtons[i].setRadioGroupId (20);
+        compareButtons[i].setClickingTogglesState(true);
+        compareButtons[i].setToggleState(audioProcessor.getPresetManager().getActiveSlot() == i, juce::dontSendNotification);
+        compareButtons[i].onClick = [this, i] {
+            if (compareButtons[i].getToggleState())
+                audioProcessor.getPresetManager().switchToSlot((PresetManager::Slot) i);
+        };
+    }
+    
     mainViewport.setViewedComponent(&contentComponent, false);
     addAndMakeVisible(mainViewport);
     
@@ -58,12 +79,19 @@ PurristAudioProcessorEditor::PurristAudioProcessorEditor (PurristAudioProcessor&
     contentComponent.addAndMakeVisible(logoShadow.get());
     contentComponent.addAndMakeVisible(logo.get());
     contentComponent.addAndMakeVisible(helpButton);
+    contentComponent.addAndMakeVisible(compareButtons[0]);
+    contentComponent.addAndMakeVisible(compareButtons[1]);
+    contentComponent.addAndMakeVisible(copyButton);
     contentComponent.addAndMakeVisible(pluginLogoShadow);
     contentComponent.addAndMakeVisible(pluginLogo);
     contentComponent.addAndMakeVisible (buzzSection);
     contentComponent.addAndMakeVisible (hissSection);
     contentComponent.addAndMakeVisible (noiseSection);
     contentComponent.addAndMakeVisible(pluginIcon.get());
+    
+    addChildComponent(diagnosticsOverlay);
+    setWantsKeyboardFocus(true);
+    
     setResizable (true, true);
     setResizeLimits(200, 100, 9999, 9999);
     setSize (1024, 620);
@@ -88,6 +116,8 @@ void PurristAudioProcessorEditor::resized()
     auto area = getLocalBounds();
     
     mainViewport.setBounds(area);
+    // Stage rows, the block row, headers, footer and up to three block size buckets
+    diagnosticsOverlay.setBounds(area.getX(), area.getY(), 300, 18 * (numChainPositions + 7) + 12);
     
     int maxHeight = 540;
     int maxWidth = 980;
@@ -142,7 +172,17 @@ void PurristAudioProcessorEditor::resized()
     auto helpButtonArea = header.removeFromRight(30);
     helpButton.setBounds(helpButtonArea);
     
-    header.removeFromRight(170);
+    /*--------------------------------------*/
+    /*------------ A / B Buttons -----------*/
+    /*--------------------------------------*/
+    
+    header.removeFromRight(12);
+    auto compareArea = header.removeFromRight(104);
+    compareButtons[0].setBounds(compareArea.removeFromLeft(30));
+    compareButtons[1].setBounds(compareArea.removeFromLeft(30));
+    copyButton.setBounds(compareArea);
+    
+    header.removeFromRight(54);
     
     /*--------------------------------------*/
     /*------------- Plugin Logo ------------*/
@@ -194,6 +234,17 @@ void PurristAudioProcessorEditor::resized()
     noiseSection.setBounds(area.removeFromLeft(narrowSectionWidth));
 }
 
+bool PurristAudioProcessorEditor::keyPressed (const juce::KeyPress& key)
+{
+    if (key == juce::KeyPress('d', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0))
+    {
+        diagnosticsOverlay.setVisible(!diagnosticsOverlay.isVisible());
+        return true;
+    }
+    
+    return false;
+}
+
 void BuzzComponent::paintSection(juce::Graphics& g)
 {
     auto area = getSectionArea();
@@ -253,6 +304,11 @@ void NoiseComponent::resized()
     
     gainReductionMeter.setBounds(area.removeFromBottom(64));
     
+    auto buttonsArea = area.removeFromBottom(40);
+    area.removeFromBottom(8);
+    spectralButton.setBounds(buttonsArea.removeFromLeft(buttonsArea.getWidth() / 2));
+    learnButton.setBounds(buttonsArea);
+    
     releaseSlider.setBounds(area.removeFromBottom((area.getHeight() - 24) / 2).withRight(area.getRight() + 15));
     area.removeFromBottom(24);
     area.removeFromTop(24);
@@ -292,6 +348,8 @@ std::vector<juce::Component*> NoiseComponent::getComponents()
         &thresholdSlider,
         &ratioSlider,
         &releaseSlider,
+        &spectralButton,
+        &learnButton,
         &gainReductionMeter
     };
 }
@@ -13,6 +13,7 @@
 #include "modules/components/GUI.h"
 #include "modules/components/ResponseCurve.h"
 #include "modules/components/GainReductionMeter.h"
+#include "modules/components/DiagnosticsOverlay.h"
 
 //==============================================================================
 /**
@@ -244,8 +245,19 @@ public:
     thresholdSliderAttachment(audioProcessor.apvts, "noise_threshold", thresholdSlider),
     ratioSliderAttachment(audioProcessor.apvts, "noise_ratio", ratioSlider.getSlider()),
     releaseSliderAttachment(audioProcessor.apvts, "noise_release", releaseSlider.getSlider()),
-    onButtonAttachment(audioProcessor.apvts, "noise_on", onButton)
+    onButtonAttachment(audioProcessor.apvts, "noise_on", onButton),
+    spectralButtonAttachment(audioProcessor.apvts, "spectral_on", spectralButton)
     {
+        spectralButton.setButtonText("Spectral");
+        spectralButton.setConnectedEdges(juce::TextButton::ConnectedOnRight);
+        spectralButton.setClickingTogglesState(true);
+        
+        learnButton.setButtonText("Learn");
+        learnButton.setConnectedEdges(juce::TextButton::ConnectedOnLeft);
+        learnButton.setClickingTogglesState(true);
+        learnButton.setToggleState(audioProcessor.isSpectralLearning(), juce::dontSendNotification);
+        learnButton.onClick = [this] { audioProcessor.setSpectralLearning(learnButton.getToggleState()); };
+        
         for (auto* component : getComponents()) {
             addAndMakeVisible(component);
         }
@@ -263,10 +275,11 @@ private:
     RotarySliderWithLabels  ratioSlider,
                             releaseSlider;
     RMSSlider thresholdSlider;
+    juce::TextButton spectralButton, learnButton;
     
     Attachment  thresholdSliderAttachment, ratioSliderAttachment,
                 releaseSliderAttachment;
-    ButtonAttachment onButtonAttachment;
+    ButtonAttachment onButtonAttachment, spectralButtonAttachment;
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NoiseComponent)
 };
@@ -284,6 +297,9 @@ public:
     void paint (juce::Graphics&) override;
     void resized() override;
     
+    /** Cmd / Ctrl + Shift + D toggles the diagnostics overlay */
+    bool keyPressed (const juce::KeyPress& key) override;
+    
     juce::Atomic<bool> filterChanged { false };
 
 private:
@@ -298,8 +314,11 @@ private:
     std::unique_ptr<juce::Drawable> logo, logoShadow, pluginIcon, pluginIconShadow;
     juce::DrawableText pluginLogo, pluginLogoShadow;
     juce::TextButton helpButton;
+    juce::TextButton compareButtons[2], copyButton;
     juce::URL helpURL{"https://straycataudio.netlify.app/purrist/user-manual/"};
     
+    DiagnosticsOverlay diagnosticsOverlay;
+    
     juce::Rectangle<int> debugRect1, debugRect2;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PurristAudioProcessorEditor)
@@ -8,6 +8,7 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "modules/diagnostics/RealtimeAudit.h"
 
 //==============================================================================
 PurristAudioProcessor::PurristAudioProcessor()
@@ -16,16 +17,21 @@ PurristAudioProcessor::PurristAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        )
 #endif
 {
+    // Hosts expect latency changes on the message thread, parameters can change on any
+    startTimerHz(10);
 }
 
 PurristAudioProcessor::~PurristAudioProcessor()
 {
+    if (publishedGroup >= 0)
+        detectorGroups->release(publishedGroup, this);
 }
 
 //==============================================================================
@@ -94,36 +100,302 @@ void PurristAudioProcessor::changeProgramName (int index, const juce::String& ne
 
 void PurristAudioProcessor::updateParameters ()
 {
-    auto chainSettings = getChainSettings(apvts);
+    auto chainSettings = getChainSettings(chainParameters);
+    
+    // High quality trades CPU for the per-sample filter redesigns and an oversampled shelf
+    auto highQuality = isHighQuality(chainSettings);
+    auto referenceEngine = highQuality || chainSettings.dspEngine > 0.5f;
+    auto hissOversampling = getHissOversampling(chainSettings);
     
     for (int channel = 0; channel < 2; channel++) {
         chain[channel].setBypassed<ChainPositions::buzzGate>(!chainSettings.buzzOn);
-        chain[channel].get<ChainPositions::buzzGate>().setThreshold(chainSettings.buzzThreshold);
-        chain[channel].get<ChainPositions::buzzGate>().setRatio(chainSettings.buzzRatio);
         chain[channel].get<ChainPositions::buzzGate>().setFrequencyID(chainSettings.buzzFrequency);
+        chain[channel].get<ChainPositions::buzzGate>().setMultirate(chainSettings.buzzMultirate);
         
         chain[channel].setBypassed<ChainPositions::hissGate>(!chainSettings.hissOn);
-        chain[channel].get<ChainPositions::hissGate>().setThreshold(chainSettings.hissThreshold);
-        chain[channel].get<ChainPositions::hissGate>().setRatio(chainSettings.hissRatio);
-        chain[channel].get<ChainPositions::hissGate>().setCutoff(chainSettings.hissCutoff);
+        chain[channel].get<ChainPositions::hissGate>().setOversampling(hissOversampling);
         
         chain[channel].setBypassed<ChainPositions::noiseGate>(!chainSettings.noiseOn);
-        chain[channel].get<ChainPositions::noiseGate>().setThreshold(chainSettings.noiseThreshold);
-        chain[channel].get<ChainPositions::noiseGate>().setRatio(chainSettings.noiseRatio);
-        chain[channel].get<ChainPositions::noiseGate>().setRelease(chainSettings.noiseRelease);
+        chain[channel].get<ChainPositions::noiseGate>().setMultiband(chainSettings.noiseMultiband);
+        
+        chain[channel].setBypassed<ChainPositions::spectralGate>(!chainSettings.spectralOn);
+        
+        chain[channel].get<ChainPositions::buzzGate>().setReferenceEngine(referenceEngine);
+        chain[channel].get<ChainPositions::hissGate>().setReferenceEngine(referenceEngine);
+        chain[channel].get<ChainPositions::noiseGate>().setReferenceEngine(referenceEngine);
+    }
+    
+    // The host only gives one value per block, ramp from the last one instead of stepping
+    const auto& previous = rampSettings[1];
+    
+    isRampPending = previous.buzzThreshold != chainSettings.buzzThreshold || previous.buzzRatio != chainSettings.buzzRatio
+                 || previous.hissThreshold != chainSettings.hissThreshold || previous.hissRatio != chainSettings.hissRatio
+                 || previous.hissCutoff != chainSettings.hissCutoff
+                 || previous.noiseThreshold != chainSettings.noiseThreshold || previous.noiseRatio != chainSettings.noiseRatio
+                 || previous.noiseRelease != chainSettings.noiseRelease
+                 || previous.spectralReduction != chainSettings.spectralReduction;
+    
+    rampSettings[0] = rampSettings[1];
+    rampSettings[1] = chainSettings;
+    
+    // Unchanged values skip the setters, their filter redesigns would dominate small blocks
+    if (isRampPending)
+        updateRampedParameters(1.f);
+    
+    updateIdleDetectors(chainSettings);
+}
+
+bool PurristAudioProcessor::isHighQuality (const ChainSettings& chainSettings) const
+{
+    switch ((int) chainSettings.qualityMode) {
+        case 1:     return false;
+        case 2:     return true;
+        // Auto, hosts flag offline renders before preparing for them
+        default:    return isNonRealtime();
+    }
+}
+
+int PurristAudioProcessor::getHissOversampling (const ChainSettings& chainSettings) const
+{
+    return isHighQuality(chainSettings) ? juce::jmax(1, (int) chainSettings.hissOversampling)
+                                        : (int) chainSettings.hissOversampling;
+}
+
+void PurristAudioProcessor::updateRampedParameters (float position)
+{
+    const auto& from = rampSettings[0];
+    const auto& to = rampSettings[1];
+    auto ramp = [position] (float start, float end) { return start + position * (end - start); };
+    
+    for (int channel = 0; channel < 2; channel++) {
+        chain[channel].get<ChainPositions::buzzGate>().setThreshold(ramp(from.buzzThreshold, to.buzzThreshold));
+        chain[channel].get<ChainPositions::buzzGate>().setRatio(ramp(from.buzzRatio, to.buzzRatio));
+        
+        chain[channel].get<ChainPositions::hissGate>().setThreshold(ramp(from.hissThreshold, to.hissThreshold));
+        chain[channel].get<ChainPositions::hissGate>().setRatio(ramp(from.hissRatio, to.hissRatio));
+        chain[channel].get<ChainPositions::hissGate>().setCutoff(ramp(from.hissCutoff, to.hissCutoff));
+        
+        chain[channel].get<ChainPositions::noiseGate>().setThreshold(ramp(from.noiseThreshold, to.noiseThreshold));
+        chain[channel].get<ChainPositions::noiseGate>().setRatio(ramp(from.noiseRatio, to.noiseRatio));
+        chain[channel].get<ChainPositions::noiseGate>().setRelease(ramp(from.noiseRelease, to.noiseRelease));
+        
+        chain[channel].get<ChainPositions::spectralGate>().setReduction(ramp(from.spectralReduction, to.spectralReduction));
+    }
+}
+
+int PurristAudioProcessor::getChainLatency (const ChainSettings& chainSettings) const
+{
+    // Computed from the settings rather than the stages, so both threads agree on it before
+    // the audio thread applies them. The gates delay their dry signal while bypassed, so
+    // their latency doesn't change during the bypass fade. The spectral gate switches
+    // without a fade
+    int latency = chain[0].get<ChainPositions::buzzGate>().getLatencyInSamples(chainSettings.buzzMultirate)
+                + chain[0].get<ChainPositions::hissGate>().getLatencyInSamples(getHissOversampling(chainSettings));
+    
+    if (chainSettings.spectralOn)
+        latency += SpectralGate<float>::getLatencyInSamples();
+    
+    return latency;
+}
+
+void PurristAudioProcessor::updateLatency()
+{
+    auto latency = getChainLatency(getChainSettings(chainParameters));
+    
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
+}
+
+void PurristAudioProcessor::timerCallback()
+{
+    updateLatency();
+}
+
+void PurristAudioProcessor::updateIdleDetectors (const ChainSettings& chainSettings)
+{
+    // The idle path can't stand in for a delayed chain, and it decides from the input, so
+    // not for detectors keyed from a sidechain or a detector group either
+    auto isSubscriber = chainSettings.groupId >= 1.f && chainSettings.groupRole >= 0.5f;
+    auto canIdle = getChainLatency(chainSettings) == 0 && chainSettings.sidechainOn < 0.5f && ! isSubscriber
+                && (chainSettings.buzzOn || chainSettings.hissOn || chainSettings.noiseOn);
+    
+    float thresholddB = 0.f;
+    
+    if (chainSettings.buzzOn)
+        thresholddB = juce::jmin(thresholddB, chainSettings.buzzThreshold);
+    
+    if (chainSettings.hissOn)
+        thresholddB = juce::jmin(thresholddB, chainSettings.hissThreshold);
+    
+    if (chainSettings.noiseOn)
+        thresholddB = juce::jmin(thresholddB, chainSettings.noiseThreshold);
+    
+    // Longest release in the chain (hiss gate, 300 ms) plus time to measure the settled output
+    auto holdTime = juce::jmax(300.f, chainSettings.noiseRelease) + 250.f;
+    
+    // ChainSettings only holds floats, any change means the measured output is stale
+    auto settingsChanged = std::memcmp(&chainSettings, &idleSettings, sizeof(ChainSettings)) != 0;
+    idleSettings = chainSettings;
+    
+    for (int channel = 0; channel < 2; channel++) {
+        idleDetector[channel].setEnabled(canIdle);
+        idleDetector[channel].setThreshold(thresholddB);
+        idleDetector[channel].setHoldTime(holdTime);
+        
+        if (settingsChanged)
+            idleDetector[channel].wake();
+    }
+}
+
+void PurristAudioProcessor::updateSidechain (const juce::dsp::AudioBlock<const float>& sidechainBlock, bool isKeyed)
+{
+    auto numKeyChannels = sidechainBlock.getNumChannels();
+    
+    for (int channel = 0; channel < 2; channel++) {
+        // A mono key drives both channels, no key leaves the detectors on their own input
+        auto keyBlock = isKeyed && numKeyChannels > 0
+                      ? sidechainBlock.getSingleChannelBlock(juce::jmin((size_t) channel, numKeyChannels - 1))
+                      : juce::dsp::AudioBlock<const float>();
+        
+        chain[channel].get<ChainPositions::buzzGate>().setSidechain(keyBlock);
+        chain[channel].get<ChainPositions::hissGate>().setSidechain(keyBlock);
+        chain[channel].get<ChainPositions::noiseGate>().setSidechain(keyBlock);
+    }
+}
+
+void PurristAudioProcessor::subscribeDetectorGroup (int group, size_t numSamples)
+{
+    // Without a live publisher, or with only torn reads of its envelopes, the stages fall back
+    // to their own detectors. The publisher shares one value per host block, the stages ramp
+    // to it over the whole block
+    auto isSubscribed = group >= 0 && detectorGroups->read(group, this, groupEnvelopes, 2 * numGroupEnvelopes);
+    
+    for (int channel = 0; channel < 2; channel++) {
+        auto* envelopes = groupEnvelopes + channel * numGroupEnvelopes;
+        auto& buzzGate = chain[channel].get<ChainPositions::buzzGate>();
+        auto& hissGate = chain[channel].get<ChainPositions::hissGate>();
+        auto& noiseGate = chain[channel].get<ChainPositions::noiseGate>();
+        
+        buzzGate.clearExternalEnvelope();
+        hissGate.clearExternalEnvelope();
+        noiseGate.clearExternalEnvelope();
+        
+        if (! isSubscribed)
+            continue;
+        
+        if (envelopes[buzzEnvelope] >= 0.f)
+            buzzGate.setExternalEnvelope(0, envelopes[buzzEnvelope], numSamples);
+        
+        if (envelopes[hissEnvelope] >= 0.f)
+            hissGate.setExternalEnvelope(0, envelopes[hissEnvelope], numSamples);
+        
+        if (envelopes[noiseEnvelope] >= 0.f)
+            noiseGate.setExternalEnvelope(0, envelopes[noiseEnvelope], numSamples);
+        
+        if (envelopes[noiseBandEnvelopes] >= 0.f)
+            for (int band = 0; band < NoiseReduction<float>::numBands; band++)
+                noiseGate.setExternalBandEnvelope(0, band, envelopes[noiseBandEnvelopes + band], numSamples);
+    }
+}
+
+void PurristAudioProcessor::publishDetectorGroup (int group)
+{
+    float envelopes[2 * numGroupEnvelopes];
+    auto isMultiband = chainParameters.noiseMultiband->load() > 0.5f;
+    
+    for (int channel = 0; channel < 2; channel++) {
+        auto* values = envelopes + channel * numGroupEnvelopes;
+        auto& noiseGate = chain[channel].get<ChainPositions::noiseGate>();
+        auto isNoiseOn = ! chain[channel].isBypassed<ChainPositions::noiseGate>();
+        
+        // Bypassed stages keep their full band detectors running, but not the band detectors,
+        // subscribers keep their own for those
+        values[buzzEnvelope] = chain[channel].get<ChainPositions::buzzGate>().getEnvelope(0);
+        values[hissEnvelope] = chain[channel].get<ChainPositions::hissGate>().getEnvelope(0);
+        values[noiseEnvelope] = ! isMultiband ? noiseGate.getEnvelope(0) : -1.f;
+        
+        for (int band = 0; band < NoiseReduction<float>::numBands; band++)
+            values[noiseBandEnvelopes + band] = isNoiseOn && isMultiband ? noiseGate.getBandEnvelope(0, band) : -1.f;
+    }
+    
+    publishedGroup = detectorGroups->publish(group, this, envelopes, 2 * numGroupEnvelopes) ? group : -1;
+}
+
+void PurristAudioProcessor::setSpectralLearning (bool shouldLearn)
+{
+    for (int channel = 0; channel < 2; channel++)
+        chain[channel].get<ChainPositions::spectralGate>().setLearning(shouldLearn);
+}
+
+bool PurristAudioProcessor::isSpectralLearning() const
+{
+    return chain[0].get<ChainPositions::spectralGate>().isLearning();
+}
+
+juce::String PurristAudioProcessor::getStageName (int stage)
+{
+    switch (stage)
+    {
+        case ChainPositions::spectralGate:  return "Spectral";
+        case ChainPositions::buzzGate:      return "Buzz";
+        case ChainPositions::hissGate:      return "Hiss";
+        case ChainPositions::noiseGate:     return "Noise";
+        default:                            return {};
+    }
+}
+
+template <int Index>
+void PurristAudioProcessor::processStageTimed (juce::dsp::ProcessContextReplacing<float>* contexts[2])
+{
+    auto start = juce::Time::getHighResolutionTicks();
+    
+    // Same as ProcessorChain::process, one stage of both channels at a time
+    for (int channel = 0; channel < 2; channel++) {
+        if (contexts[channel] == nullptr)
+            continue;
+        
+        contexts[channel]->isBypassed = chain[channel].isBypassed<Index>();
+        chain[channel].get<Index>().process(*contexts[channel]);
     }
+    
+    stageTimers.addStage(Index, juce::Time::getHighResolutionTicks() - start);
+}
+
+void PurristAudioProcessor::skipChain (int channel, juce::dsp::AudioBlock<float> block)
+{
+    // The spectral gate has latency, it's bypassed whenever the chain can be skipped. The
+    // later stages key from the input instead of the output of the stages before them
+    juce::dsp::ProcessContextReplacing<float> context(block);
+    auto& channelChain = chain[channel];
+    
+    context.isBypassed = channelChain.isBypassed<ChainPositions::buzzGate>();
+    channelChain.get<ChainPositions::buzzGate>().skip(context);
+    
+    context.isBypassed = channelChain.isBypassed<ChainPositions::hissGate>();
+    channelChain.get<ChainPositions::hissGate>().skip(context);
+    
+    context.isBypassed = channelChain.isBypassed<ChainPositions::noiseGate>();
+    channelChain.get<ChainPositions::noiseGate>().skip(context);
 }
 
 void PurristAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     juce::dsp::ProcessSpec spec;
     
-    spec.maximumBlockSize = samplesPerBlock;
+    // The chain and the idle detectors never see more than one sub-block
+    juce::ignoreUnused(samplesPerBlock);
+    spec.maximumBlockSize = subBlockSize;
     spec.numChannels = 1;
     spec.sampleRate = sampleRate;
     
     updateParameters();
     
+    // Nothing to ramp from after a restart
+    rampSettings[0] = rampSettings[1];
+    isRampPending = false;
+    subBlockPosition = 0;
+    updateRampedParameters(1.f);
+    
     for (int channel = 0; channel < 2; channel++) {
         chain[channel].get<ChainPositions::buzzGate>().setAttack(50);
         chain[channel].get<ChainPositions::buzzGate>().setRelease(150);
@@ -134,7 +406,10 @@ void PurristAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBloc
         chain[channel].get<ChainPositions::noiseGate>().setAttack(30);
         
         chain[channel].prepare(spec);
+        idleDetector[channel].prepare(spec);
     }
+    
+    updateLatency();
 }
 
 void PurristAudioProcessor::releaseResources()
@@ -162,6 +437,17 @@ bool PurristAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+    
+    // The sidechain key is optional, mono or stereo
+    if (layouts.inputBuses.size() > 1)
+    {
+        auto sidechain = layouts.getChannelSet(true, 1);
+        
+        if (! sidechain.isDisabled()
+         && sidechain != juce::AudioChannelSet::mono()
+         && sidechain != juce::AudioChannelSet::stereo())
+            return false;
+    }
    #endif
 
     return true;
@@ -171,6 +457,7 @@ bool PurristAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 
 void PurristAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    RealtimeAudit::ScopedAudioThread audioThread;
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -184,19 +471,84 @@ void PurristAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
     
+    auto isTimed = stageTimers.isEnabled();
+    auto blockStart = isTimed ? juce::Time::getHighResolutionTicks() : 0;
+    
     updateParameters();
 
+    auto sidechainBuffer = getBusBuffer(buffer, true, 1);
+    juce::dsp::AudioBlock<const float> sidechainBlock(sidechainBuffer);
+    auto isKeyed = chainParameters.sidechainOn->load() > 0.5f;
+    
+    // Group 0 is off, the publisher runs its own detectors and shares them after the chain
+    auto group = (int) chainParameters.groupId->load() - 1;
+    auto isPublisher = group >= 0 && chainParameters.groupRole->load() < 0.5f;
+    
+    if (publishedGroup >= 0 && (publishedGroup != group || ! isPublisher)) {
+        detectorGroups->release(publishedGroup, this);
+        publishedGroup = -1;
+    }
+    
+    auto numSamples = (size_t) buffer.getNumSamples();
+    subscribeDetectorGroup(isPublisher ? -1 : group, numSamples);
+    
     juce::dsp::AudioBlock<float> block(buffer);
     
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
+    if (isTimed)
+        stageTimers.beginBlock(buffer.getNumSamples(), getSampleRate());
     
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    for (size_t offset = 0, length = 0; offset < numSamples; offset += length) {
+        length = juce::jmin((size_t) subBlockSize - subBlockPosition, numSamples - offset);
+        subBlockPosition = (subBlockPosition + length) % (size_t) subBlockSize;
+        
+        if (isRampPending)
+            updateRampedParameters((float) (offset + length) / (float) numSamples);
+        
+        updateSidechain(sidechainBlock.getSubBlock(offset, length), isKeyed);
+        
+        // The idle detectors skip the chain up to where the input wakes it, if they skip it at all
+        size_t skipLength[2];
+        bool runChain[2];
+        
+        for (int channel = 0; channel < 2; channel++) {
+            skipLength[channel] = idleDetector[channel].pushInput(buffer.getReadPointer(channel, (int) offset), length);
+            runChain[channel] = skipLength[channel] < length;
+            
+            if (skipLength[channel] > 0)
+                skipChain(channel, block.getSingleChannelBlock((size_t) channel).getSubBlock(offset, skipLength[channel]));
+        }
+        
+        auto leftBlock = block.getSingleChannelBlock(0).getSubBlock(offset + skipLength[0], length - skipLength[0]);
+        auto rightBlock = block.getSingleChannelBlock(1).getSubBlock(offset + skipLength[1], length - skipLength[1]);
+        
+        juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
+        juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+        
+        if (isTimed) {
+            juce::dsp::ProcessContextReplacing<float>* contexts[] { runChain[0] ? &leftContext : nullptr,
+                                                                    runChain[1] ? &rightContext : nullptr };
+            
+            processStageTimed<ChainPositions::spectralGate>(contexts);
+            processStageTimed<ChainPositions::buzzGate>(contexts);
+            processStageTimed<ChainPositions::hissGate>(contexts);
+            processStageTimed<ChainPositions::noiseGate>(contexts);
+        } else {
+            if (runChain[0])
+                chain[0].process(leftContext);
+            
+            if (runChain[1])
+                chain[1].process(rightContext);
+        }
+        
+        for (int channel = 0; channel < 2; channel++)
+            idleDetector[channel].processOutput(buffer.getWritePointer(channel, (int) offset), length);
+    }
     
-    chain[0].process(leftContext);
-    chain[1].process(rightContext);
+    if (isPublisher)
+        publishDetectorGroup(group);
     
+    if (isTimed)
+        stageTimers.endBlock(juce::Time::getHighResolutionTicks() - blockStart);
 }
 
 //==============================================================================
@@ -218,8 +570,33 @@ void PurristAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
     
+    // Parameter block in a fixed order, then the number of noise profiles, the profile of
+    // each channel (number of bins, 0 without a profile, followed by the power values as
+    // little-endian floats) and the A/B slots
     juce::MemoryOutputStream mos(destData, true);
-    apvts.state.writeToStream(mos);
+    presetManager.writeState(mos);
+    mos.writeInt(2);
+    
+    for (int channel = 0; channel < 2; channel++) {
+        auto& spectralGate = chain[channel].get<ChainPositions::spectralGate>();
+        
+        if (spectralGate.hasNoiseProfile())
+        {
+            float profile[SpectralGate<float>::getNumBins()];
+            spectralGate.getNoiseProfile(profile);
+            
+            mos.writeInt(SpectralGate<float>::getNumBins());
+            
+            for (auto power : profile)
+                mos.writeFloat(power);
+        }
+        else
+        {
+            mos.writeInt(0);
+        }
+    }
+    
+    presetManager.writeSlots(mos);
 }
 
 void PurristAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
@@ -227,32 +604,130 @@ void PurristAudioProcessor::setStateInformation (const void* data, int sizeInByt
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
     
+    if (PresetManager::isBinaryState(data, sizeInBytes)) {
+        juce::MemoryInputStream mis(data, (size_t) sizeInBytes, false);
+        
+        auto version = presetManager.readState(mis);
+        
+        if (version == 0)
+            return;
+        
+        // Version 1 always has both profiles, they may be cut off though
+        auto numProfiles = version < 2 ? 2 : mis.readInt();
+        
+        for (int channel = 0; channel < 2; channel++) {
+            auto& spectralGate = chain[channel].get<ChainPositions::spectralGate>();
+            auto numBins = channel < numProfiles ? mis.readInt() : 0;
+            
+            if (numBins == SpectralGate<float>::getNumBins() && mis.getNumBytesRemaining() >= (juce::int64) sizeof(float) * numBins) {
+                float profile[SpectralGate<float>::getNumBins()];
+                
+                for (auto& power : profile)
+                    power = mis.readFloat();
+                
+                spectralGate.setNoiseProfile(profile);
+                continue;
+            }
+            
+            // No profile or one of another size, a profile learnt before doesn't belong to this state
+            spectralGate.clearNoiseProfile();
+            
+            if (numBins > 0)
+                mis.skipNextBytes((juce::int64) sizeof(float) * numBins);
+        }
+        
+        presetManager.readSlots(mis, version);
+        updateParameters();
+        return;
+    }
+    
+    // States saved before the binary format
     auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
     
     if (tree.isValid()) {
         apvts.replaceState(tree);
+        
+        for (int channel = 0; channel < 2; channel++) {
+            auto* profile = tree.getProperty("spectral_profile_" + juce::String(channel)).getBinaryData();
+            
+            auto& spectralGate = chain[channel].get<ChainPositions::spectralGate>();
+            
+            if (profile != nullptr && profile->getSize() == sizeof(float) * SpectralGate<float>::getNumBins())
+                spectralGate.setNoiseProfile(static_cast<const float*>(profile->getData()));
+            else
+                spectralGate.clearNoiseProfile();
+        }
+        
         updateParameters();
     }
 }
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+ChainParameters getChainParameters(juce::AudioProcessorValueTreeState& apvts)
+{
+    ChainParameters parameters;
+    
+    parameters.buzzOn = apvts.getRawParameterValue("buzz_on");
+    parameters.buzzThreshold = apvts.getRawParameterValue("buzz_threshold");
+    parameters.buzzRatio = apvts.getRawParameterValue("buzz_ratio");
+    parameters.buzzFrequency = apvts.getRawParameterValue("buzz_frequency");
+    parameters.buzzMultirate = apvts.getRawParameterValue("buzz_multirate");
+    
+    parameters.hissOn = apvts.getRawParameterValue("hiss_on");
+    parameters.hissThreshold = apvts.getRawParameterValue("hiss_threshold");
+    parameters.hissRatio = apvts.getRawParameterValue("hiss_ratio");
+    parameters.hissCutoff = apvts.getRawParameterValue("hiss_cutoff");
+    parameters.hissOversampling = apvts.getRawParameterValue("hiss_oversampling");
+    
+    parameters.noiseOn = apvts.getRawParameterValue("noise_on");
+    parameters.noiseThreshold = apvts.getRawParameterValue("noise_threshold");
+    parameters.noiseRatio = apvts.getRawParameterValue("noise_ratio");
+    parameters.noiseRelease = apvts.getRawParameterValue("noise_release");
+    parameters.noiseMultiband = apvts.getRawParameterValue("noise_multiband");
+    
+    parameters.spectralOn = apvts.getRawParameterValue("spectral_on");
+    parameters.spectralReduction = apvts.getRawParameterValue("spectral_reduction");
+    
+    parameters.sidechainOn = apvts.getRawParameterValue("sidechain_on");
+    parameters.groupId = apvts.getRawParameterValue("group_id");
+    parameters.groupRole = apvts.getRawParameterValue("group_role");
+    
+    parameters.dspEngine = apvts.getRawParameterValue("dsp_engine");
+    parameters.qualityMode = apvts.getRawParameterValue("quality_mode");
+    
+    return parameters;
+}
+
+ChainSettings getChainSettings(const ChainParameters& parameters)
 {
     ChainSettings settings;
     
-    settings.buzzOn = apvts.getRawParameterValue("buzz_on")->load() > 0.5f;
-    settings.buzzThreshold = apvts.getRawParameterValue("buzz_threshold")->load();
-    settings.buzzRatio = apvts.getRawParameterValue("buzz_ratio")->load();
-    settings.buzzFrequency = apvts.getRawParameterValue("buzz_frequency")->load();
+    settings.buzzOn = parameters.buzzOn->load() > 0.5f;
+    settings.buzzThreshold = parameters.buzzThreshold->load();
+    settings.buzzRatio = parameters.buzzRatio->load();
+    settings.buzzFrequency = parameters.buzzFrequency->load();
+    settings.buzzMultirate = parameters.buzzMultirate->load() > 0.5f;
+    
+    settings.hissOn = parameters.hissOn->load() > 0.5f;
+    settings.hissThreshold = parameters.hissThreshold->load();
+    settings.hissRatio = parameters.hissRatio->load();
+    settings.hissCutoff = parameters.hissCutoff->load();
+    settings.hissOversampling = parameters.hissOversampling->load();
     
-    settings.hissOn = apvts.getRawParameterValue("hiss_on")->load() > 0.5f;
-    settings.hissThreshold = apvts.getRawParameterValue("hiss_threshold")->load();
-    settings.hissRatio = apvts.getRawParameterValue("hiss_ratio")->load();
-    settings.hissCutoff = apvts.getRawParameterValue("hiss_cutoff")->load();
+    settings.noiseOn = parameters.noiseOn->load() > 0.5f;
+    settings.noiseThreshold = parameters.noiseThreshold->load();
+    settings.noiseRatio = parameters.noiseRatio->load();
+    settings.noiseRelease = parameters.noiseRelease->load();
+    settings.noiseMultiband = parameters.noiseMultiband->load() > 0.5f;
     
-    settings.noiseOn = apvts.getRawParameterValue("noise_on")->load() > 0.5f;
-    settings.noiseThreshold = apvts.getRawParameterValue("noise_threshold")->load();
-    settings.noiseRatio = apvts.getRawParameterValue("noise_ratio")->load();
-    settings.noiseRelease = apvts.getRawParameterValue("noise_release")->load();
+    settings.spectralOn = parameters.spectralOn->load() > 0.5f;
+    settings.spectralReduction = parameters.spectralReduction->load();
+    
+    settings.sidechainOn = parameters.sidechainOn->load() > 0.5f;
+    settings.groupId = parameters.groupId->load();
+    settings.groupRole = parameters.groupRole->load();
+    
+    settings.dspEngine = parameters.dspEngine->load();
+    settings.qualityMode = parameters.qualityMode->load();
     
     return settings ;
 }
@@ -300,6 +775,14 @@ juce::AudioProcessorValueTreeState::ParameterLayout PurristAudioProcessor::creat
         )
     );
     
+    layout.add(
+        std::make_unique<juce::AudioParameterBool>(
+            juce::ParameterID("buzz_multirate", 1),
+            "Buzz Multirate",
+            false
+        )
+    );
+    
     layout.add(
         std::make_unique<juce::AudioParameterFloat>(
             juce::ParameterID("hiss_threshold", 1),
@@ -335,6 +818,20 @@ juce::AudioProcessorValueTreeState::ParameterLayout PurristAudioProcessor::creat
         )
     );
     
+    juce::StringArray hissOversamplingOptions;
+    hissOversamplingOptions.add("Off");
+    hissOversamplingOptions.add("2x");
+    hissOversamplingOptions.add("4x");
+    
+    layout.add(
+        std::make_unique<juce::AudioParameterChoice>(
+            juce::ParameterID("hiss_oversampling", 1),
+            "Fizz Oversampling",
+            hissOversamplingOptions,
+            0
+        )
+    );
+    
     layout.add(
         std::make_unique<juce::AudioParameterFloat>(
             juce::ParameterID("noise_threshold", 1),
@@ -370,6 +867,99 @@ juce::AudioProcessorValueTreeState::ParameterLayout PurristAudioProcessor::creat
         )
     );
     
+    layout.add(
+        std::make_unique<juce::AudioParameterBool>(
+            juce::ParameterID("noise_multiband", 1),
+            "Noise Multiband",
+            false
+        )
+    );
+    
+    layout.add(
+        std::make_unique<juce::AudioParameterFloat>(
+            juce::ParameterID("spectral_reduction", 1),
+            "Spectral Reduction",
+            juce::NormalisableRange<float>(0.f, 40.f, 0.1f, 1.f),
+            18.f
+        )
+    );
+    
+    layout.add(
+        std::make_unique<juce::AudioParameterBool>(
+            juce::ParameterID("spectral_on", 1),
+            "Spectral On",
+            false
+        )
+    );
+    
+    layout.add(
+        std::make_unique<juce::AudioParameterBool>(
+            juce::ParameterID("sidechain_on", 1),
+            "Sidechain Key",
+            false
+        )
+    );
+    
+    juce::StringArray groupOptions;
+    groupOptions.add("Off");
+    
+    for (int group = 1; group <= DetectorGroups::numGroups; group++)
+        groupOptions.add(juce::String(group));
+    
+    juce::StringArray groupRoleOptions;
+    groupRoleOptions.add("Publish");
+    groupRoleOptions.add("Subscribe");
+    
+    layout.add(
+        std::make_unique<juce::AudioParameterChoice>(
+            juce::ParameterID("group_id", 1),
+            "Detector Group",
+            groupOptions,
+            0
+        )
+    );
+    
+    layout.add(
+        std::make_unique<juce::AudioParameterChoice>(
+            juce::ParameterID("group_role", 1),
+            "Detector Group Role",
+            groupRoleOptions,
+            1
+        )
+    );
+    
+    juce::StringArray dspEngineOptions;
+    dspEngineOptions.add("Fast");
+    dspEngineOptions.add("Reference");
+    
+    // For null tests of the optimised engine, kept away from host automation
+    layout.add(
+        std::make_unique<juce::AudioParameterChoice>(
+            juce::ParameterID("dsp_engine", 1),
+            "DSP Engine",
+            dspEngineOptions,
+            0,
+            juce::AudioParameterChoiceAttributes().withAutomatable(false)
+        )
+    );
+    
+    juce::StringArray qualityModeOptions;
+    qualityModeOptions.add("Auto");
+    qualityModeOptions.add("Realtime");
+    qualityModeOptions.add("High");
+    
+    // Auto runs the fast engine live and the reference engine with an oversampled
+    // shelf for offline renders. Switching changes the latency, so not automatable
+    layout.add(
+        std::make_unique<juce::AudioParameterChoice>(
+            juce::ParameterID("quality_mode", 1),
+            "Quality",
+            qualityModeOptions,
+            0,
+            juce::AudioParameterChoiceAttributes().withAutomatable(false)
+        )
+    );
+    
     return layout;
 }
 
@@ -12,29 +12,55 @@
 #include "modules/processors/BuzzGate.h"
 #include "modules/processors/HissGate.h"
 #include "modules/processors/NoiseReduction.h"
+#include "modules/processors/SpectralGate.h"
+#include "modules/processors/IdleDetector.h"
+#include "modules/processors/DetectorGroups.h"
+#include "modules/diagnostics/StageTimers.h"
+#include "modules/presets/PresetManager.h"
 
 struct ChainSettings
 {
-    float buzzOn{ true }, buzzThreshold { 1.f }, buzzRatio { 4.f }, buzzFrequency { 0 };
-    float hissOn{ true }, hissThreshold { 1.f }, hissRatio { 4.f }, hissCutoff { 0 };
-    float noiseOn{ true }, noiseThreshold { 1.f }, noiseRatio { 4.f }, noiseRelease { 0 };
+    float buzzOn{ true }, buzzThreshold { 1.f }, buzzRatio { 4.f }, buzzFrequency { 0 }, buzzMultirate { false };
+    float hissOn{ true }, hissThreshold { 1.f }, hissRatio { 4.f }, hissCutoff { 0 }, hissOversampling { 0 };
+    float noiseOn{ true }, noiseThreshold { 1.f }, noiseRatio { 4.f }, noiseRelease { 0 }, noiseMultiband { false };
+    float spectralOn{ false }, spectralReduction { 18.f };
+    float sidechainOn{ false };
+    float groupId { 0 }, groupRole { 0 };
+    float dspEngine { 0 }, qualityMode { 0 };
 };
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
+/** Raw parameter values, looked up once so the audio thread skips the string compares. */
+struct ChainParameters
+{
+    std::atomic<float> *buzzOn{ nullptr }, *buzzThreshold{ nullptr }, *buzzRatio{ nullptr }, *buzzFrequency{ nullptr }, *buzzMultirate{ nullptr };
+    std::atomic<float> *hissOn{ nullptr }, *hissThreshold{ nullptr }, *hissRatio{ nullptr }, *hissCutoff{ nullptr }, *hissOversampling{ nullptr };
+    std::atomic<float> *noiseOn{ nullptr }, *noiseThreshold{ nullptr }, *noiseRatio{ nullptr }, *noiseRelease{ nullptr }, *noiseMultiband{ nullptr };
+    std::atomic<float> *spectralOn{ nullptr }, *spectralReduction{ nullptr };
+    std::atomic<float> *sidechainOn{ nullptr };
+    std::atomic<float> *groupId{ nullptr }, *groupRole{ nullptr };
+    std::atomic<float> *dspEngine{ nullptr }, *qualityMode{ nullptr };
+};
+
+ChainParameters getChainParameters(juce::AudioProcessorValueTreeState& apvts);
+ChainSettings getChainSettings(const ChainParameters& parameters);
 
-using MonoChain = juce::dsp::ProcessorChain<BuzzGate<float>, HissGate<float>, NoiseReduction<float>>;
+using MonoChain = juce::dsp::ProcessorChain<SpectralGate<float>, BuzzGate<float>, HissGate<float>, NoiseReduction<float>>;
 
 enum ChainPositions
 {
+    spectralGate,
     buzzGate,
     hissGate,
     noiseGate
 };
 
+constexpr int numChainPositions = ChainPositions::noiseGate + 1;
+
 //==============================================================================
 /**
 */
-class PurristAudioProcessor  : public juce::AudioProcessor
+class PurristAudioProcessor  : public juce::AudioProcessor,
+                               private juce::Timer
 {
 public:
     //==============================================================================
@@ -77,9 +103,73 @@ public:
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     juce::AudioProcessorValueTreeState apvts{*this, nullptr, "Parameters", createParameterLayout()};
     MonoChain chain[2];
+    
+    //==============================================================================
+    /** Starts or finishes capturing the spectral noise profile on both channels. */
+    void setSpectralLearning (bool shouldLearn);
+    bool isSpectralLearning() const;
+    
+    //==============================================================================
+    /** Per-stage timing of processBlock, off until enabled with getStageTimers().setEnabled(true). */
+    StageTimers& getStageTimers() { return stageTimers; }
+    
+    /** Returns the display name of a ChainPositions stage. */
+    static juce::String getStageName (int stage);
+    
+    //==============================================================================
+    /** Binary state layout and A/B comparison slots. */
+    PresetManager& getPresetManager() { return presetManager; }
 
 private:
+    ChainParameters chainParameters { getChainParameters(apvts) };
+    PresetManager presetManager { apvts };
+    
     void updateParameters();
+    bool isHighQuality (const ChainSettings& chainSettings) const;
+    int getHissOversampling (const ChainSettings& chainSettings) const;
+    void updateRampedParameters (float position);
+    int getChainLatency (const ChainSettings& chainSettings) const;
+    void updateLatency();
+    void timerCallback() override;
+    void updateIdleDetectors (const ChainSettings& chainSettings);
+    void updateSidechain (const juce::dsp::AudioBlock<const float>& sidechainBlock, bool isKeyed);
+    void subscribeDetectorGroup (int group, size_t numSamples);
+    void publishDetectorGroup (int group);
+    
+    void skipChain (int channel, juce::dsp::AudioBlock<float> block);
+    
+    template <int Index>
+    void processStageTimed (juce::dsp::ProcessContextReplacing<float>* contexts[2]);
+    
+    StageTimers stageTimers { numChainPositions };
+    
+    // The chain always runs in sub-blocks of this size on a grid that carries over between
+    // host blocks, a host block edge only splits a sub-block. Continuous parameters ramp
+    // from the values of the previous block to the current ones between sub-blocks, the
+    // rest switch at the start of the block
+    static constexpr int subBlockSize = 32;
+    size_t subBlockPosition = 0;
+    ChainSettings rampSettings[2];
+    bool isRampPending = false;
+    
+    IdleDetector<float> idleDetector[2];
+    ChainSettings idleSettings;
+    
+    // Per channel layout of the envelopes shared with a detector group, negative for a stage without one
+    enum GroupEnvelopes
+    {
+        buzzEnvelope,
+        hissEnvelope,
+        noiseEnvelope,
+        noiseBandEnvelopes,
+        numGroupEnvelopes = noiseBandEnvelopes + NoiseReduction<float>::numBands
+    };
+    
+    static_assert (2 * numGroupEnvelopes <= DetectorGroups::maxEnvelopes, "Group envelopes don't fit a slot");
+    
+    juce::SharedResourcePointer<DetectorGroups> detectorGroups;
+    float groupEnvelopes[2 * numGroupEnvelopes] {};
+    int publishedGroup = -1;
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PurristAudioProcessor)
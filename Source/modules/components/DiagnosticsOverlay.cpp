@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    DiagnosticsOverlay.cpp
+
+  ==============================================================================
+*/
+
+#include "DiagnosticsOverlay.h"
+#include "GUI.h"
+
+void DiagnosticsOverlay::paint(juce::Graphics& g)
+{
+    auto area = getLocalBounds();
+    int lineHeight = 18;
+    
+    g.setColour(juce::Colours::black.withAlpha(0.8f));
+    g.fillRect(area);
+    
+    area.reduce(8, 6);
+    
+    g.setFont(getFont());
+    g.setFont(15);
+    g.setColour(juce::Colours::white);
+    
+    auto drawRow = [&] (const juce::String& name, double average, double peak, double budget)
+    {
+        auto row = area.removeFromTop(lineHeight);
+        
+        g.drawText(name, row.removeFromLeft(70), juce::Justification::centredLeft);
+        g.drawText(juce::String(average, 1) + " us", row.removeFromLeft(70), juce::Justification::centredRight);
+        g.drawText(juce::String(peak, 1) + " us", row.removeFromLeft(70), juce::Justification::centredRight);
+        g.drawText(juce::String(budget, 2) + " %", row, juce::Justification::centredRight);
+    };
+    
+    auto header = area.removeFromTop(lineHeight);
+    g.drawText("Stage", header.removeFromLeft(70), juce::Justification::centredLeft);
+    g.drawText("Mean", header.removeFromLeft(70), juce::Justification::centredRight);
+    g.drawText("Peak", header.removeFromLeft(70), juce::Justification::centredRight);
+    g.drawText("Budget", header, juce::Justification::centredRight);
+    
+    for (int stage = 0; stage < snapshot.numStages; stage++)
+        drawRow(PurristAudioProcessor::getStageName(stage), snapshot.averageMicroseconds[stage],
+                snapshot.peakMicroseconds[stage], snapshot.budgetPercentage[stage]);
+    
+    drawRow("Block", snapshot.averageBlockMicroseconds, snapshot.peakBlockMicroseconds, snapshot.blockBudgetPercentage);
+    
+    // Block load percentiles per block size bucket, in percent of the block length
+    auto drawLoadRow = [&] (const juce::String& name, const juce::String (&values)[5])
+    {
+        auto row = area.removeFromTop(lineHeight);
+        
+        g.drawText(name, row.removeFromLeft(64), juce::Justification::centredLeft);
+        
+        for (auto& value : values)
+            g.drawText(value, row.removeFromLeft(44), juce::Justification::centredRight);
+    };
+    
+    drawLoadRow("Size", { "p50", "p99", "p99.9", "Max", "Late" });
+    
+    for (const auto& loads : snapshot.bucketLoads)
+    {
+        if (loads.numBlocks == 0)
+            continue;
+        
+        // The footer keeps its line
+        if (area.getHeight() < 2 * lineHeight)
+            break;
+        
+        auto blockSizes = loads.minBlockSize == loads.maxBlockSize
+                        ? juce::String(loads.maxBlockSize)
+                        : juce::String(loads.minBlockSize) + "-" + juce::String(loads.maxBlockSize);
+        
+        drawLoadRow(blockSizes, { juce::String(loads.loadPercentage50, 1), juce::String(loads.loadPercentage99, 1),
+                                  juce::String(loads.loadPercentage999, 1), juce::String(loads.peakLoadPercentage, 1),
+                                  juce::String(loads.numLateBlocks) });
+    }
+    
+    g.drawText(juce::String(snapshot.numBlocks) + " blocks, load in %, late over " + juce::String(snapshot.deadlinePercentage, 0) + " %",
+               area.removeFromTop(lineHeight), juce::Justification::centredLeft);
+}
+
+void DiagnosticsOverlay::visibilityChanged()
+{
+    auto& stageTimers = audioProcessor.getStageTimers();
+    
+    if (isVisible())
+    {
+        stageTimers.reset();
+        stageTimers.setEnabled(true);
+        startTimerHz(4);
+    }
+    else
+    {
+        stopTimer();
+        stageTimers.setEnabled(false);
+    }
+}
+
+void DiagnosticsOverlay::timerCallback()
+{
+    snapshot = audioProcessor.getStageTimers().getSnapshot();
+    repaint();
+}
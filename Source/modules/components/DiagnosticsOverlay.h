@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    DiagnosticsOverlay.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../PluginProcessor.h"
+
+//==============================================================================
+/**
+    Hidden panel with the per-stage timings of the processor and the block load
+    percentiles of every block size bucket. Timing is only enabled on the audio
+    thread while the overlay is visible.
+*/
+class DiagnosticsOverlay   : public juce::Component,
+juce::Timer
+{
+public:
+    DiagnosticsOverlay(PurristAudioProcessor& p) : audioProcessor (p) {
+        setInterceptsMouseClicks(false, false);
+    }
+    
+    ~DiagnosticsOverlay() override {
+        audioProcessor.getStageTimers().setEnabled(false);
+    }
+    
+    void paint (juce::Graphics& g) override;
+    void visibilityChanged() override;
+    
+    void timerCallback() override;
+
+private:
+    PurristAudioProcessor& audioProcessor;
+    StageTimers::Snapshot snapshot;
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DiagnosticsOverlay)
+};
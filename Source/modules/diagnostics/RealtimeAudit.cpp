@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    RealtimeAudit.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeAudit.h"
+
+#if PURRIST_REALTIME_AUDIT
+
+#include <cstdlib>
+#include <new>
+
+#if JUCE_LINUX
+ #include <dlfcn.h>
+ #include <pthread.h>
+#endif
+
+namespace RealtimeAudit
+{
+    namespace
+    {
+        thread_local int audioThreadDepth = 0;
+        thread_local bool isReporting = false;
+        std::atomic<int> numViolations { 0 };
+    }
+    
+    ScopedAudioThread::ScopedAudioThread()
+    {
+        ++audioThreadDepth;
+    }
+    
+    ScopedAudioThread::~ScopedAudioThread()
+    {
+        --audioThreadDepth;
+    }
+    
+    int getNumViolations()
+    {
+        return numViolations.load();
+    }
+    
+    void resetViolations()
+    {
+        numViolations.store (0);
+    }
+    
+    void reportViolation (const char* description)
+    {
+        if (audioThreadDepth == 0 || isReporting)
+            return;
+        
+        // Logging allocates too, don't report the report
+        isReporting = true;
+        ++numViolations;
+        juce::Logger::writeToLog (juce::String ("Realtime violation on the audio thread: ") + description
+                                  + "\n" + juce::SystemStats::getStackBacktrace());
+        isReporting = false;
+    }
+}
+
+//==============================================================================
+static void* allocateAudited (std::size_t size)
+{
+    RealtimeAudit::reportViolation ("operator new");
+    
+    if (auto* pointer = std::malloc (size != 0 ? size : 1))
+        return pointer;
+    
+    throw std::bad_alloc();
+}
+
+static void freeAudited (void* pointer) noexcept
+{
+    if (pointer != nullptr)
+        RealtimeAudit::reportViolation ("operator delete");
+    
+    std::free (pointer);
+}
+
+void* operator new   (std::size_t size)   { return allocateAudited (size); }
+void* operator new[] (std::size_t size)   { return allocateAudited (size); }
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeAudit::reportViolation ("operator new");
+    return std::malloc (size != 0 ? size : 1);
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeAudit::reportViolation ("operator new");
+    return std::malloc (size != 0 ? size : 1);
+}
+
+void operator delete   (void* pointer) noexcept                 { freeAudited (pointer); }
+void operator delete[] (void* pointer) noexcept                 { freeAudited (pointer); }
+void operator delete   (void* pointer, std::size_t) noexcept    { freeAudited (pointer); }
+void operator delete[] (void* pointer, std::size_t) noexcept    { freeAudited (pointer); }
+
+//==============================================================================
+#if JUCE_LINUX
+using MutexLockFunction = int (*) (pthread_mutex_t*);
+
+static MutexLockFunction getRealMutexLock()
+{
+    return reinterpret_cast<MutexLockFunction> (dlsym (RTLD_NEXT, "pthread_mutex_lock"));
+}
+
+// Resolved at load time, a function-local static would itself take a lock
+static MutexLockFunction realMutexLock = getRealMutexLock();
+
+extern "C" int pthread_mutex_lock (pthread_mutex_t* mutex)
+{
+    RealtimeAudit::reportViolation ("pthread_mutex_lock");
+    
+    if (realMutexLock == nullptr)
+        realMutexLock = getRealMutexLock();
+    
+    return realMutexLock (mutex);
+}
+#endif
+
+#endif
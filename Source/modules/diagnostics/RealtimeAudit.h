@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    RealtimeAudit.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+    Debug-only check that the audio thread never allocates or locks.
+
+    Build with PURRIST_REALTIME_AUDIT=1 to replace operator new/delete (and
+    pthread_mutex_lock on Linux). Any call made while a ScopedAudioThread is
+    alive is logged together with a stack trace and counted. The Standalone
+    target picks the replacements up for the whole process; a Linux plugin
+    loaded by a host needs -Wl,-Bsymbolic-functions to bind its own calls here.
+    Without the flag everything here compiles to nothing.
+*/
+#ifndef PURRIST_REALTIME_AUDIT
+ #define PURRIST_REALTIME_AUDIT 0
+#endif
+
+namespace RealtimeAudit
+{
+#if PURRIST_REALTIME_AUDIT
+    //==============================================================================
+    /** Marks the calling thread as the audio thread while in scope. */
+    struct ScopedAudioThread
+    {
+        ScopedAudioThread();
+        ~ScopedAudioThread();
+        
+        JUCE_DECLARE_NON_COPYABLE (ScopedAudioThread)
+    };
+
+    /** Returns the number of allocations and locks seen on the audio thread. */
+    int getNumViolations();
+    
+    /** Sets the violation counter back to zero. */
+    void resetViolations();
+    
+    /** Logs and counts a violation if called from the audio thread. */
+    void reportViolation (const char* description);
+#else
+    struct ScopedAudioThread
+    {
+        ScopedAudioThread() {}
+    };
+
+    inline int getNumViolations() { return 0; }
+    inline void resetViolations() {}
+#endif
+}
@@ -0,0 +1,307 @@
+/*
+  ==============================================================================
+
+    StageTimers.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Block-granularity timing of the processing stages. The audio thread is the
+    only writer and adds high resolution ticks to relaxed atomics; any other
+    thread can take a snapshot at any time. Counters are read one by one, so a
+    snapshot may mix two consecutive blocks, which is fine for diagnostics.
+    
+    The load of every block (its processing time over its length) also goes
+    into a histogram with 8 bins per octave, for percentiles that averages hide.
+    Small blocks spend the same fixed costs on fewer samples, so there is one
+    histogram per bucket of block sizes (up to 32, 64, ... 2048 samples and
+    longer), reported separately.
+*/
+class StageTimers
+{
+public:
+    static constexpr int maxStages = 8;
+    
+    // Buckets of block sizes up to 32 << bucket samples, the last one takes all longer blocks
+    static constexpr int numSizeBuckets = 8, smallestBucketSize = 32;
+    
+    /** Block loads of the blocks of one size bucket, in percent of their length. */
+    struct BucketLoads
+    {
+        int minBlockSize = 0, maxBlockSize = 0;
+        juce::int64 numBlocks = 0, numLateBlocks = 0;
+        
+        /** Percentiles to within one histogram bin. */
+        double loadPercentage50 = 0, loadPercentage99 = 0, loadPercentage999 = 0, peakLoadPercentage = 0;
+    };
+
+    struct Snapshot
+    {
+        int numStages = 0;
+        juce::int64 numBlocks = 0;
+        
+        /** Mean and worst time per block in microseconds, per stage. */
+        double averageMicroseconds[maxStages] {}, peakMicroseconds[maxStages] {};
+        
+        /** Share of the real time budget (block length) used by each stage. */
+        double budgetPercentage[maxStages] {};
+        
+        double averageBlockMicroseconds = 0, peakBlockMicroseconds = 0, blockBudgetPercentage = 0;
+        
+        /** Block loads per size bucket, empty buckets have no blocks. */
+        BucketLoads bucketLoads[numSizeBuckets];
+        
+        /** Blocks of any size whose load went over the deadline fraction. */
+        juce::int64 numLateBlocks = 0;
+        double deadlinePercentage = 0;
+    };
+    
+    explicit StageTimers (int numStagesToTime) : numStages (juce::jmin (numStagesToTime, maxStages))
+    {
+        jassert (numStagesToTime <= maxStages);
+    }
+    
+    //==============================================================================
+    /** Timing is off by default, the chain is then processed without any clock reads. */
+    void setEnabled (bool shouldBeEnabled)  { enabled.store (shouldBeEnabled); }
+    bool isEnabled() const                  { return enabled.load (std::memory_order_relaxed); }
+    
+    /** Asks the audio thread to clear the counters at the start of the next block. */
+    void reset()                            { resetPending.store (true); }
+    
+    /** Share of the block length above which a block counts as late, 0.5 by default. */
+    void setDeadlineFraction (double newFraction)   { deadlineFraction.store (newFraction); }
+    
+    //==============================================================================
+    /** Audio thread only. */
+    void beginBlock (int numSamples, double sampleRate) noexcept
+    {
+        if (resetPending.exchange (false))
+            clear();
+        
+        currentBudgetTicks = sampleRate > 0 ? (juce::int64) ((double) numSamples / sampleRate * (double) juce::Time::getHighResolutionTicksPerSecond())
+                                            : 0;
+        add (budgetTicks, currentBudgetTicks);
+        
+        currentBucket = getSizeBucket (numSamples);
+        auto& bucket = buckets[currentBucket];
+        
+        if (numSamples < bucket.minBlockSize.load (std::memory_order_relaxed) || bucket.numBlocks.load (std::memory_order_relaxed) == 0)
+            bucket.minBlockSize.store (numSamples, std::memory_order_relaxed);
+        
+        if (numSamples > bucket.maxBlockSize.load (std::memory_order_relaxed))
+            bucket.maxBlockSize.store (numSamples, std::memory_order_relaxed);
+        
+        std::fill (std::begin (currentBlockTicks), std::end (currentBlockTicks), (juce::int64) 0);
+    }
+    
+    /** Audio thread only, may be called several times per stage and block. */
+    void addStage (int stage, juce::int64 ticks) noexcept
+    {
+        jassert (juce::isPositiveAndBelow (stage, numStages));
+        
+        add (stageTicks[stage], ticks);
+        currentBlockTicks[stage] += ticks;
+    }
+    
+    /** Audio thread only. */
+    void endBlock (juce::int64 ticks) noexcept
+    {
+        for (int stage = 0; stage < numStages; stage++)
+            keepMaximum (stagePeakTicks[stage], currentBlockTicks[stage]);
+        
+        add (blockTicks, ticks);
+        keepMaximum (blockPeakTicks, ticks);
+        
+        auto& bucket = buckets[currentBucket];
+        
+        if (currentBudgetTicks > 0)
+        {
+            auto load = (double) ticks / (double) currentBudgetTicks;
+            
+            add (bucket.loadHistogram[getHistogramBin (load)], 1);
+            keepMaximum (bucket.peakLoadPpm, (juce::int64) (load * 1.0e6));
+            
+            if (load > deadlineFraction.load (std::memory_order_relaxed))
+                add (bucket.numLateBlocks, 1);
+        }
+        
+        add (bucket.numBlocks, 1);
+        add (numBlocks, 1);
+    }
+    
+    //==============================================================================
+    Snapshot getSnapshot() const
+    {
+        Snapshot snapshot;
+        snapshot.numStages = numStages;
+        snapshot.numBlocks = numBlocks.load (std::memory_order_relaxed);
+        
+        if (snapshot.numBlocks == 0)
+            return snapshot;
+        
+        auto microsecondsPerTick = 1.0e6 / (double) juce::Time::getHighResolutionTicksPerSecond();
+        auto budget = (double) juce::jmax ((juce::int64) 1, budgetTicks.load (std::memory_order_relaxed));
+        auto blocks = (double) snapshot.numBlocks;
+        
+        for (int stage = 0; stage < numStages; stage++)
+        {
+            auto ticks = (double) stageTicks[stage].load (std::memory_order_relaxed);
+            
+            snapshot.averageMicroseconds[stage] = ticks / blocks * microsecondsPerTick;
+            snapshot.peakMicroseconds[stage] = (double) stagePeakTicks[stage].load (std::memory_order_relaxed) * microsecondsPerTick;
+            snapshot.budgetPercentage[stage] = 100.0 * ticks / budget;
+        }
+        
+        auto ticks = (double) blockTicks.load (std::memory_order_relaxed);
+        
+        snapshot.averageBlockMicroseconds = ticks / blocks * microsecondsPerTick;
+        snapshot.peakBlockMicroseconds = (double) blockPeakTicks.load (std::memory_order_relaxed) * microsecondsPerTick;
+        snapshot.blockBudgetPercentage = 100.0 * ticks / budget;
+        
+        for (int index = 0; index < numSizeBuckets; index++)
+        {
+            const auto& bucket = buckets[index];
+            auto& loads = snapshot.bucketLoads[index];
+            
+            loads.numBlocks = bucket.numBlocks.load (std::memory_order_relaxed);
+            
+            if (loads.numBlocks == 0)
+                continue;
+            
+            juce::int64 histogram[numHistogramBins], numLoads = 0;
+            
+            for (int bin = 0; bin < numHistogramBins; bin++)
+            {
+                histogram[bin] = bucket.loadHistogram[bin].load (std::memory_order_relaxed);
+                numLoads += histogram[bin];
+            }
+            
+            loads.loadPercentage50 = 100.0 * getPercentile (histogram, numLoads, 0.5);
+            loads.loadPercentage99 = 100.0 * getPercentile (histogram, numLoads, 0.99);
+            loads.loadPercentage999 = 100.0 * getPercentile (histogram, numLoads, 0.999);
+            loads.peakLoadPercentage = 1.0e-4 * (double) bucket.peakLoadPpm.load (std::memory_order_relaxed);
+            loads.numLateBlocks = bucket.numLateBlocks.load (std::memory_order_relaxed);
+            loads.minBlockSize = bucket.minBlockSize.load (std::memory_order_relaxed);
+            loads.maxBlockSize = bucket.maxBlockSize.load (std::memory_order_relaxed);
+            
+            snapshot.numLateBlocks += loads.numLateBlocks;
+        }
+        
+        snapshot.deadlinePercentage = 100.0 * deadlineFraction.load (std::memory_order_relaxed);
+        
+        return snapshot;
+    }
+    
+private:
+    using Counter = std::atomic<juce::int64>;
+    
+    // Loads from 2^-12 to 2^4 of the block length, the outer bins also take everything beyond
+    static constexpr int binsPerOctave = 8, lowestOctave = -12, numHistogramBins = 16 * binsPerOctave;
+    
+    static int getSizeBucket (int numSamples) noexcept
+    {
+        int bucket = 0;
+        
+        while (bucket < numSizeBuckets - 1 && numSamples > (smallestBucketSize << bucket))
+            bucket++;
+        
+        return bucket;
+    }
+    
+    static int getHistogramBin (double load) noexcept
+    {
+        if (load <= 0)
+            return 0;
+        
+        auto bin = (int) std::floor ((std::log2 (load) - lowestOctave) * binsPerOctave);
+        return juce::jlimit (0, numHistogramBins - 1, bin);
+    }
+    
+    /** Upper edge of the bin the given share of the loads falls in. */
+    static double getPercentile (const juce::int64* histogram, juce::int64 numLoads, double share) noexcept
+    {
+        if (numLoads == 0)
+            return 0;
+        
+        auto rank = (juce::int64) std::ceil (share * (double) numLoads);
+        juce::int64 count = 0;
+        int bin = 0;
+        
+        for (; bin < numHistogramBins - 1; bin++)
+        {
+            count += histogram[bin];
+            
+            if (count >= rank)
+                break;
+        }
+        
+        return std::exp2 ((double) (bin + 1) / binsPerOctave + lowestOctave);
+    }
+    
+    static void add (Counter& counter, juce::int64 value) noexcept
+    {
+        counter.store (counter.load (std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+    
+    static void keepMaximum (Counter& counter, juce::int64 value) noexcept
+    {
+        if (value > counter.load (std::memory_order_relaxed))
+            counter.store (value, std::memory_order_relaxed);
+    }
+    
+    void clear() noexcept
+    {
+        for (int stage = 0; stage < numStages; stage++)
+        {
+            stageTicks[stage].store (0, std::memory_order_relaxed);
+            stagePeakTicks[stage].store (0, std::memory_order_relaxed);
+        }
+        
+        blockTicks.store (0, std::memory_order_relaxed);
+        blockPeakTicks.store (0, std::memory_order_relaxed);
+        budgetTicks.store (0, std::memory_order_relaxed);
+        numBlocks.store (0, std::memory_order_relaxed);
+        
+        for (auto& bucket : buckets)
+        {
+            for (auto& count : bucket.loadHistogram)
+                count.store (0, std::memory_order_relaxed);
+            
+            bucket.numBlocks.store (0, std::memory_order_relaxed);
+            bucket.peakLoadPpm.store (0, std::memory_order_relaxed);
+            bucket.numLateBlocks.store (0, std::memory_order_relaxed);
+            bucket.minBlockSize.store (0, std::memory_order_relaxed);
+            bucket.maxBlockSize.store (0, std::memory_order_relaxed);
+        }
+    }
+    
+    //==============================================================================
+    const int numStages;
+    std::atomic<bool> enabled { false }, resetPending { false };
+    
+    Counter stageTicks[maxStages] {}, stagePeakTicks[maxStages] {};
+    Counter blockTicks { 0 }, blockPeakTicks { 0 }, budgetTicks { 0 }, numBlocks { 0 };
+    
+    struct Bucket
+    {
+        Counter loadHistogram[numHistogramBins] {};
+        Counter numBlocks { 0 }, peakLoadPpm { 0 }, numLateBlocks { 0 };
+        std::atomic<int> minBlockSize { 0 }, maxBlockSize { 0 };
+    };
+    
+    Bucket buckets[numSizeBuckets];
+    std::atomic<double> deadlineFraction { 0.5 };
+    
+    // Sums of the sub-blocks of the current block, its length in ticks and its size bucket, audio thread only
+    juce::int64 currentBlockTicks[maxStages] {}, currentBudgetTicks = 0;
+    int currentBucket = 0;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StageTimers)
+};
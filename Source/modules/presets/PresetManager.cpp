@@ -0,0 +1,162 @@
+/*
+  ==============================================================================
+
+    PresetManager.cpp
+
+  ==============================================================================
+*/
+
+#include "PresetManager.h"
+
+// Order of the binary state, append only
+const char* const PresetManager::parameterIDs[PresetManager::numParameters]
+{
+    "buzz_on", "buzz_threshold", "buzz_ratio", "buzz_frequency", "buzz_multirate",
+    "hiss_on", "hiss_threshold", "hiss_ratio", "hiss_cutoff", "hiss_oversampling",
+    "noise_on", "noise_threshold", "noise_ratio", "noise_release", "noise_multiband",
+    "spectral_on", "spectral_reduction",
+    "sidechain_on",
+    "group_id", "group_role",
+    "dsp_engine",
+    "quality_mode"
+};
+
+PresetManager::PresetManager (juce::AudioProcessorValueTreeState& apvts)
+{
+    for (int i = 0; i < numParameters; i++) {
+        parameters[i] = apvts.getParameter(parameterIDs[i]);
+        rawValues[i] = apvts.getRawParameterValue(parameterIDs[i]);
+
+        // Every parameter of the layout must be listed, and only those
+        jassert (parameters[i] != nullptr && rawValues[i] != nullptr);
+    }
+
+    getValues(slots[slotA]);
+}
+
+//==============================================================================
+void PresetManager::getValues (Values& values) const
+{
+    for (int i = 0; i < numParameters; i++)
+        values[i] = rawValues[i]->load();
+}
+
+void PresetManager::setValues (const Values& values)
+{
+    for (int i = 0; i < numParameters; i++) {
+        // Unchanged parameters skip the host and listener notifications
+        if (values[i] == rawValues[i]->load())
+            continue;
+
+        parameters[i]->setValueNotifyingHost(parameters[i]->convertTo0to1(values[i]));
+    }
+}
+
+//==============================================================================
+void PresetManager::writeState (juce::OutputStream& stream) const
+{
+    stream.writeInt((int) stateMagic);
+    stream.writeInt((int) stateVersion);
+    stream.writeInt(numParameters);
+
+    for (int i = 0; i < numParameters; i++)
+        stream.writeFloat(rawValues[i]->load());
+}
+
+bool PresetManager::isBinaryState (const void* data, int sizeInBytes)
+{
+    return data != nullptr && sizeInBytes >= stateHeaderSize
+        && juce::ByteOrder::littleEndianInt(data) == stateMagic;
+}
+
+juce::uint32 PresetManager::readState (juce::InputStream& stream)
+{
+    if ((juce::uint32) stream.readInt() != stateMagic)
+        return 0;
+
+    auto version = (juce::uint32) stream.readInt();
+    auto numStoredValues = stream.readInt();
+
+    // A newer format may move things around, an older one only has fewer values
+    if (version == 0 || version > stateVersion || numStoredValues < 0
+     || stream.getNumBytesRemaining() < (juce::int64) numStoredValues * (juce::int64) sizeof(float))
+        return 0;
+
+    Values values;
+
+    for (int i = 0; i < numParameters; i++)
+        values[i] = i < numStoredValues ? stream.readFloat()
+                                        : parameters[i]->convertFrom0to1(parameters[i]->getDefaultValue());
+
+    stream.skipNextBytes((juce::int64) juce::jmax(0, numStoredValues - numParameters) * (juce::int64) sizeof(float));
+
+    setValues(values);
+    return version;
+}
+
+//==============================================================================
+void PresetManager::switchToSlot (Slot newSlot)
+{
+    getValues(slots[activeSlot]);
+
+    if (newSlot == activeSlot)
+        return;
+
+    if (! isSlotUsed[newSlot]) {
+        slots[newSlot] = slots[activeSlot];
+        isSlotUsed[newSlot] = true;
+    }
+
+    activeSlot = newSlot;
+    setValues(slots[activeSlot]);
+}
+
+void PresetManager::copyToOtherSlot()
+{
+    auto otherSlot = activeSlot == slotA ? slotB : slotA;
+
+    getValues(slots[otherSlot]);
+    isSlotUsed[otherSlot] = true;
+}
+
+void PresetManager::writeSlots (juce::OutputStream& stream) const
+{
+    // The active slot is the parameter block, only the other one needs its values
+    auto otherSlot = activeSlot == slotA ? slotB : slotA;
+
+    stream.writeInt((int) activeSlot);
+    stream.writeInt(isSlotUsed[otherSlot] ? numParameters : 0);
+
+    if (isSlotUsed[otherSlot])
+        for (auto value : slots[otherSlot])
+            stream.writeFloat(value);
+}
+
+void PresetManager::readSlots (juce::InputStream& stream, juce::uint32 version)
+{
+    auto storedSlot = version < 3 ? 0 : stream.readInt();
+    auto numStoredValues = version < 3 ? 0 : stream.readInt();
+
+    activeSlot = storedSlot == slotB ? slotB : slotA;
+    getValues(slots[activeSlot]);
+    isSlotUsed[activeSlot] = true;
+
+    auto otherSlot = activeSlot == slotA ? slotB : slotA;
+
+    // A cut off slot is dropped rather than half restored
+    isSlotUsed[otherSlot] = numStoredValues > 0
+                         && stream.getNumBytesRemaining() >= (juce::int64) numStoredValues * (juce::int64) sizeof(float);
+
+    if (! isSlotUsed[otherSlot])
+        return;
+
+    // Values missing from the stored slot keep the ones of the active slot
+    slots[otherSlot] = slots[activeSlot];
+
+    for (int i = 0; i < numStoredValues; i++) {
+        auto value = stream.readFloat();
+
+        if (i < numParameters)
+            slots[otherSlot][(size_t) i] = value;
+    }
+}
@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    PresetManager.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Parameter values in a fixed order, used for the binary plugin state and for
+    the A/B comparison slots.
+
+    The binary state starts with a header (magic "PRST", format version, number
+    of values) followed by the plain parameter values as little-endian floats,
+    in the order of parameterIDs. Anything the processor stores after that
+    (e.g. noise profiles) follows the parameter block, readState() returns the
+    version so the processor knows the layout of its part. New parameters must be
+    appended to parameterIDs, never inserted, so older states still read back;
+    values missing from an older state fall back to the parameter defaults.
+
+    A/B switching copies between preallocated arrays and the parameters, so
+    it never allocates. The processor stores the slots at the end of its state
+    with writeSlots(), the active one holds the values of the parameter block.
+*/
+class PresetManager
+{
+public:
+    static constexpr int numParameters = 22;
+    static const char* const parameterIDs[numParameters];
+
+    static constexpr juce::uint32 stateMagic = 0x54535250;   // "PRST" in little-endian
+    // 2: the noise profiles are preceded by their number
+    // 3: the A/B slots follow the noise profiles
+    static constexpr juce::uint32 stateVersion = 3;
+    static constexpr int stateHeaderSize = 3 * sizeof (juce::uint32);
+
+    using Values = std::array<float, numParameters>;
+
+    enum Slot
+    {
+        slotA,
+        slotB
+    };
+
+    /** Looks the parameters up once, all later accesses go through the cached pointers. */
+    explicit PresetManager (juce::AudioProcessorValueTreeState& apvts);
+
+    //==============================================================================
+    /** Copies the current plain parameter values. */
+    void getValues (Values& values) const;
+
+    /** Sets the parameters from plain values and notifies the host of the ones that changed. */
+    void setValues (const Values& values);
+
+    //==============================================================================
+    /** Writes the state header and parameter block. */
+    void writeState (juce::OutputStream& stream) const;
+
+    /** Returns true if the data starts with the binary state header. */
+    static bool isBinaryState (const void* data, int sizeInBytes);
+
+    /** Reads a parameter block written by writeState(), leaving the stream at the data
+        that follows it. Returns the format version of the state, or 0 (and changes
+        nothing) if the data is invalid.
+    */
+    juce::uint32 readState (juce::InputStream& stream);
+
+    //==============================================================================
+    /** Stores the current values in the active slot and loads the given one. A slot
+        that was never used starts as a copy of the active one.
+    */
+    void switchToSlot (Slot newSlot);
+
+    /** Copies the current values to the slot that isn't active. */
+    void copyToOtherSlot();
+
+    Slot getActiveSlot() const noexcept     { return activeSlot; }
+
+    /** Writes the active slot and the values of the other one, if it was used. */
+    void writeSlots (juce::OutputStream& stream) const;
+
+    /** Reads the slots written by writeSlots() after readState() has set the current
+        values. States before version 3 have none, their values start again in slot A.
+    */
+    void readSlots (juce::InputStream& stream, juce::uint32 version);
+
+private:
+    //==============================================================================
+    juce::RangedAudioParameter* parameters[numParameters];
+    std::atomic<float>* rawValues[numParameters];
+
+    Values slots[2];
+    bool isSlotUsed[2] { true, false };
+    Slot activeSlot = slotA;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetManager)
+};
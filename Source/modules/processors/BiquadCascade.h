@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    BiquadCascade.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Serial chain of biquads with the coefficients and states held by value in
+    flat arrays, one array per coefficient (structure of arrays). Unlike a row
+    of juce::dsp::IIR::Filter there is no reference counted Coefficients
+    object to chase or copy, redesigning a stage writes five numbers, and the
+    stage loop has a compile-time trip count the compiler can unroll.
+
+    Same transposed direct form II as juce::dsp::IIR::Filter, so both give
+    the same output for the same coefficients. All channels share the
+    coefficients and keep their own state.
+*/
+template <typename SampleType, int numStages, int numChannels = 2>
+class BiquadCascade
+{
+public:
+    /** Starts with every stage passing the signal through. */
+    BiquadCascade() noexcept
+    {
+        std::fill (std::begin (b0), std::end (b0), static_cast<SampleType> (1));
+    }
+
+    //==============================================================================
+    /** Sets one stage from the raw { b0, b1, b2, a0, a1, a2 } returned by
+        juce::dsp::IIR::ArrayCoefficients, normalising by a0.
+    */
+    void setStage (int stage, const std::array<SampleType, 6>& coefficients) noexcept
+    {
+        jassert (juce::isPositiveAndBelow (stage, numStages));
+
+        auto a0Inverse = static_cast<SampleType> (1.0) / coefficients[3];
+
+        b0[stage] = coefficients[0] * a0Inverse;
+        b1[stage] = coefficients[1] * a0Inverse;
+        b2[stage] = coefficients[2] * a0Inverse;
+        a1[stage] = coefficients[4] * a0Inverse;
+        a2[stage] = coefficients[5] * a0Inverse;
+    }
+
+    /** Clears the filter states of all channels. */
+    void reset() noexcept
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            std::fill (std::begin (s1[channel]), std::end (s1[channel]), static_cast<SampleType> (0));
+            std::fill (std::begin (s2[channel]), std::end (s2[channel]), static_cast<SampleType> (0));
+        }
+    }
+
+    /** Rounds decaying states to zero before they become denormals. */
+    void snapToZero() noexcept
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            for (int stage = 0; stage < numStages; ++stage)
+            {
+                juce::dsp::util::snapToZero (s1[channel][stage]);
+                juce::dsp::util::snapToZero (s2[channel][stage]);
+            }
+        }
+    }
+
+    //==============================================================================
+    /** Runs one sample through every stage. */
+    SampleType processSample (int channel, SampleType sample) noexcept
+    {
+        jassert (juce::isPositiveAndBelow (channel, numChannels));
+
+        auto* state1 = s1[channel];
+        auto* state2 = s2[channel];
+
+        for (int stage = 0; stage < numStages; ++stage)
+        {
+            auto output = b0[stage] * sample + state1[stage];
+            state1[stage] = b1[stage] * sample - a1[stage] * output + state2[stage];
+            state2[stage] = b2[stage] * sample - a2[stage] * output;
+            sample = output;
+        }
+
+        return sample;
+    }
+
+private:
+    //==============================================================================
+    alignas (64) SampleType b0[numStages] {}, b1[numStages] {}, b2[numStages] {},
+                            a1[numStages] {}, a2[numStages] {};
+    alignas (64) SampleType s1[numChannels][numStages] {}, s2[numChannels][numStages] {};
+};
@@ -26,123 +26,190 @@
 //}
 
 template <typename SampleType>
-BuzzGate<SampleType>::BuzzGate()
+BuzzGate<SampleType>::BuzzGate() : Gate<SampleType> (static_cast<SampleType> (-15.0))
 {
     update();
-
-    RMSFilter.setLevelCalculationType (juce::dsp::BallisticsFilterLevelCalculationType::RMS);
-    RMSFilter.setAttackTime  (static_cast<SampleType> (0.0));
-    RMSFilter.setReleaseTime (static_cast<SampleType> (50.0));
-}
-
-template <typename SampleType>
-void BuzzGate<SampleType>::setThreshold (SampleType newValue)
-{
-    thresholddB = newValue;
-    update();
 }
 
 template <typename SampleType>
-void BuzzGate<SampleType>::setRatio (SampleType newRatio)
+void BuzzGate<SampleType>::setFrequencyID (int newFrequencyID)
 {
-    jassert (newRatio >= static_cast<SampleType> (1.0));
-
-    ratio = newRatio;
+    if (frequencyID == newFrequencyID)
+        return;
+    
+    frequencyID = newFrequencyID;   // 0 = 50 Hz, 1 = 60 Hz
     update();
+    designHumFilters();
 }
 
 template <typename SampleType>
-void BuzzGate<SampleType>::setAttack (SampleType newAttack)
+void BuzzGate<SampleType>::setMultirate (bool shouldUseMultirate)
 {
-    attackTime = newAttack;
-    update();
+    if (multirate == shouldUseMultirate)
+        return;
+    
+    multirate = shouldUseMultirate;
+    previousGain = -1;
+    resetLowBand();
+    this->bypassFader.setLatency (getLatencyInSamples());
 }
 
 template <typename SampleType>
-void BuzzGate<SampleType>::setRelease (SampleType newRelease)
+int BuzzGate<SampleType>::getLatencyInSamples (bool withMultirate) const
 {
-    releaseTime = newRelease;
-    update();
+    // Triangular decimator and linear interpolator delay by D - 1 and D samples
+    return withMultirate ? 2 * decimationFactor - 1 : 0;
 }
 
 template <typename SampleType>
-void BuzzGate<SampleType>::setFrequencyID (int newFrequencyID)
+void BuzzGate<SampleType>::resetEngineFilters()
 {
-    frequencyID = newFrequencyID;   // 0 = 50 Hz, 1 = 60 Hz
-    update();
+    // The comb runs in both engines and keeps its state
+    previousGain = -1;
+    humFilters.reset();
+    resetLowBand();
 }
 
 //==============================================================================
 template <typename SampleType>
 void BuzzGate<SampleType>::prepare (const juce::dsp::ProcessSpec& spec)
 {
-    jassert (spec.sampleRate > 0);
-    jassert (spec.numChannels > 0);
-
-    sampleRate = spec.sampleRate;
-
-    RMSFilter.prepare (spec);
-    envelopeFilter.prepare (spec);
+    Gate<SampleType>::prepare (spec);
     
     delayLine.prepare(spec);
     delayLine.setMaximumDelayInSamples(sampleRate * 0.01);
     delayLine.setDelay(sampleRate / delaySampleDivider);
     
-    int buzzFilterFreq = 50;
-    for (int channel = 0; channel < 2 && channel; channel++) {
+    // Filters start at order 1, assign the biquads here so the audio thread never reallocates their state
+    for (int channel = 0; channel < 2; channel++) {
+        int buzzFilterFreq = 50;
         for (int instance = 0; instance < 6; instance++) {
             *buzzFilter[channel][instance].coefficients = juce::dsp::IIR::ArrayCoefficients<SampleType>::makePeakFilter(sampleRate, (SampleType)buzzFilterFreq, 1000, 1);
             buzzFilter[channel][instance].prepare (spec);
             buzzFilterFreq += 50;
         }
     }
+    
+    decimationFactor = juce::jmax(1, juce::roundToInt(sampleRate / lowBandTargetRate));
+    lowSampleRate = sampleRate / decimationFactor;
+    decimationGain = static_cast<SampleType> (1.0 / (decimationFactor * decimationFactor));
+    
+    alignmentDelay.prepare(spec);
+    alignmentDelay.setMaximumDelayInSamples(2 * decimationFactor);
+    alignmentDelay.setDelay(static_cast<SampleType> (2 * decimationFactor - 1));
+    
+    this->bypassFader.setMaximumLatency (2 * decimationFactor - 1);
+    this->bypassFader.setLatency (getLatencyInSamples());
+    
+    for (int channel = 0; channel < 2; channel++) {
+        for (int i = 0; i < 6; i++) {
+            *lowBuzzFilter[channel][i].coefficients = juce::dsp::IIR::ArrayCoefficients<SampleType>::makePeakFilter(lowSampleRate, (SampleType)(50 * (i + 1)), 75, 1);
+            lowBuzzFilter[channel][i].prepare (spec);
+        }
+    }
 
     update();
+    designHumFilters();
     reset();
 }
 
 template <typename SampleType>
 void BuzzGate<SampleType>::reset()
 {
-    RMSFilter.reset();
-    envelopeFilter.reset();
+    Gate<SampleType>::reset();
+    resetFilters();
+}
+
+template <typename SampleType>
+void BuzzGate<SampleType>::resetFilters()
+{
+    isOpen[0] = isOpen[1] = false;
     delayLine.reset();
-    for (int channel = 0; channel < 2 && channel; channel++) {
+    for (int channel = 0; channel < 2; channel++) {
         for (int instance = 0; instance < 6; instance++) {
             buzzFilter[channel][instance].reset();
         }
     }
+    
+    previousGain = -1;
+    humFilters.reset();
+    resetLowBand();
 }
 
-//==============================================================================
 template <typename SampleType>
-SampleType BuzzGate<SampleType>::processSample (int channel, SampleType sample)
+void BuzzGate<SampleType>::snapToZero() noexcept
 {
-    SampleType modifiedSample, delayedSample;
+    Gate<SampleType>::snapToZero();
     
-    delayLine.pushSample(channel, sample);
-    delayedSample = delayLine.popSample(channel);
-    delayLine.setDelay(sampleRate / delaySampleDivider);
+    for (int channel = 0; channel < 2; channel++) {
+        for (int instance = 0; instance < 6; instance++) {
+            buzzFilter[channel][instance].snapToZero();
+            lowBuzzFilter[channel][instance].snapToZero();
+        }
+        
+        juce::dsp::util::snapToZero(lowBandState[channel].correction);
+    }
+    
+    humFilters.snapToZero();
+    lowBuzzCascade.snapToZero();
+}
+
+template <typename SampleType>
+void BuzzGate<SampleType>::resetLowBand()
+{
+    alignmentDelay.reset();
+    previousLowGain = -1;
     
-    // RMS ballistics filter
-    auto env = RMSFilter.processSample (channel, sample);
+    for (int channel = 0; channel < 2; channel++) {
+        lowBandState[channel] = {};
+        
+        for (int i = 0; i < 6; i++)
+            lowBuzzFilter[channel][i].reset();
+    }
     
-    if (!channel)
-        this->setInputRMS(float(env));
+    lowBuzzCascade.reset();
+}
 
-    // Ballistics filter
-    env = envelopeFilter.processSample (channel, env);
+//==============================================================================
+template <typename SampleType>
+void BuzzGate<SampleType>::processGate (const juce::dsp::AudioBlock<const SampleType>& inputBlock,
+                                        juce::dsp::AudioBlock<SampleType>& outputBlock) noexcept
+{
+    const auto numChannels = outputBlock.getNumChannels();
+    const auto numSamples  = outputBlock.getNumSamples();
     
-    auto minGain = juce::Decibels::decibelsToGain(static_cast<SampleType> (-15.0));
-    auto gain = (env > threshold) ? static_cast<SampleType> (1.0)
-                                  : std::pow (env * thresholdInverse, currentRatio - static_cast<SampleType> (1.0));
-    gain = std::max(gain, minGain);
+    for (size_t channel = 0; channel < numChannels && channel < 2; ++channel)
+    {
+        auto* inputSamples  = inputBlock .getChannelPointer (channel);
+        auto* outputSamples = outputBlock.getChannelPointer (channel);
+        auto* keySamples    = this->getKeySamples (channel, inputSamples, numSamples);
+        
+        if (! referenceEngine)
+        {
+            if (multirate)
+                processLowBandBlock ((int) channel, inputSamples, keySamples, outputSamples, numSamples);
+            else
+                processCascadeBlock ((int) channel, inputSamples, keySamples, outputSamples, numSamples);
+            
+            continue;
+        }
+
+        for (size_t i = 0; i < numSamples; ++i)
+            outputSamples[i] = processSample ((int) channel, inputSamples[i], keySamples[i]);
+    }
+}
+
+template <typename SampleType>
+SampleType BuzzGate<SampleType>::processSample (int channel, SampleType sample, SampleType key)
+{
+    SampleType gain;
+    auto modifiedSample = processComb (channel, sample, key, gain);
     
-    if (!channel)
-        this->setGainReduction(juce::Decibels::gainToDecibels(gain));
+    if (multirate)
+        return processLowBand (channel, modifiedSample, gain);
     
-    auto combGain = 1 - gain;
-    modifiedSample = (sample + delayedSample * combGain) * (1 - 0.3f * combGain);
+    if (! referenceEngine)
+        return processCascade (channel, modifiedSample, gain);
     
     int buzzFilterFreq = frequencyID ? 60 : 50;
     for (int i = 0; i < 6; i++) {
@@ -165,16 +232,184 @@ SampleType BuzzGate<SampleType>::processSample (int channel, SampleType sample)
     return modifiedSample;
 }
 
+template <typename SampleType>
+SampleType BuzzGate<SampleType>::processComb (int channel, SampleType sample, SampleType key, SampleType& gain)
+{
+    gain = this->processGain (channel, key);
+    
+    if (!channel)
+        this->setGainReduction(juce::Decibels::gainToDecibels(gain));
+    
+    return applyComb (channel, sample, gain);
+}
+
+template <typename SampleType>
+SampleType BuzzGate<SampleType>::applyComb (int channel, SampleType sample, SampleType gain)
+{
+    SampleType delayedSample;
+    
+    delayLine.pushSample(channel, sample);
+    delayedSample = delayLine.popSample(channel);
+    delayLine.setDelay(sampleRate / delaySampleDivider);
+    
+    auto combGain = 1 - gain;
+    return (sample + delayedSample * combGain) * (1 - 0.3f * combGain);
+}
+
+template <typename SampleType>
+SampleType BuzzGate<SampleType>::processCascade (int channel, SampleType sample, SampleType gain)
+{
+    return humFilters.processPeak (channel, sample, gain);
+}
+
+template <typename SampleType>
+void BuzzGate<SampleType>::processCascadeBlock (int channel, const SampleType* input, const SampleType* key,
+                                                SampleType* output, size_t numSamples) noexcept
+{
+    SampleType gains[controlInterval];
+    
+    for (size_t start = 0, length = 0; start < numSamples; start += length)
+    {
+        length = juce::jmin (numSamples - start, detector.getSamplesToNextInterval (channel));
+        
+        auto isUnity = detector.isUnityGain (channel);
+        this->processDetector (channel, key + start, gains, length);
+        
+        if (isUnity)
+        {
+            // Comb and hum filters are identity. The delay line keeps its history so the
+            // comb comes back on the current signal, the hum filters restart from silence
+            // and fade in with the gain, instead of ringing with a stale state
+            if (! isOpen[channel])
+                humFilters.reset (channel);
+            
+            isOpen[channel] = true;
+            
+            for (size_t i = start; i < start + length; ++i)
+            {
+                delayLine.pushSample(channel, input[i]);
+                delayLine.popSample(channel);
+                output[i] = input[i];
+            }
+            
+            continue;
+        }
+        
+        isOpen[channel] = false;
+        
+        for (size_t i = 0; i < length; ++i)
+            output[start + i] = applyComb (channel, input[start + i], gains[i]);
+        
+        humFilters.processPeak (channel, output + start, gains, length);
+    }
+    
+    if (!channel)
+        this->setGainReduction(juce::Decibels::gainToDecibels(detector.getGain (channel)));
+}
+
+template <typename SampleType>
+void BuzzGate<SampleType>::designHumFilters()
+{
+    auto buzzFilterFreq = frequencyID ? 60 : 50;
+    
+    for (int i = 0; i < 6; i++)
+        humFilters.setStage (i, sampleRate, (SampleType) (buzzFilterFreq * (i + 1)), 75);
+}
+
+template <typename SampleType>
+void BuzzGate<SampleType>::designCascade (BiquadCascade<SampleType, 6>& cascade, double rate, SampleType gain)
+{
+    auto buzzFilterFreq = frequencyID ? 60 : 50;
+    
+    for (int i = 0; i < 6; i++)
+        cascade.setStage (i, juce::dsp::IIR::ArrayCoefficients<SampleType>::makePeakFilter (rate, (SampleType) (buzzFilterFreq * (i + 1)), 75, gain));
+}
+
+template <typename SampleType>
+SampleType BuzzGate<SampleType>::processLowBand (int channel, SampleType sample, SampleType gain)
+{
+    auto& state = lowBandState[channel];
+    
+    alignmentDelay.pushSample(channel, sample);
+    auto delayedSample = alignmentDelay.popSample(channel);
+    
+    // Correction computed one low rate period ago, interpolated towards the latest one
+    auto position = static_cast<SampleType> (state.phase + 1) / static_cast<SampleType> (decimationFactor);
+    auto correction = state.previousCorrection + position * (state.correction - state.previousCorrection);
+    
+    state.sum += sample;
+    state.rampSum += static_cast<SampleType> (state.phase) * sample;
+    
+    if (++state.phase == decimationFactor)
+    {
+        // Triangular window over the last two periods: weights k in the previous one, D - k in this one
+        auto lowSample = (state.previousRampSum + decimationFactor * state.sum - state.rampSum) * decimationGain;
+        
+        state.previousRampSum = state.rampSum;
+        state.sum = 0;
+        state.rampSum = 0;
+        state.phase = 0;
+        
+        int buzzFilterFreq = frequencyID ? 60 : 50;
+        auto filteredSample = lowSample;
+        
+        if (! referenceEngine)
+        {
+            if (gain != previousLowGain && !channel)
+                designCascade (lowBuzzCascade, lowSampleRate, gain);
+            
+            filteredSample = lowBuzzCascade.processSample (channel, lowSample);
+        }
+        else
+        {
+            for (int i = 0; i < 6; i++) {
+                if (gain != previousLowGain)
+                {
+                    if (!channel)
+                    {
+                        *lowBuzzFilter[channel][i].coefficients = juce::dsp::IIR::ArrayCoefficients<SampleType>::makePeakFilter(lowSampleRate, (SampleType)buzzFilterFreq, 75, gain);
+                    } else {
+                        *lowBuzzFilter[channel][i].coefficients = *lowBuzzFilter[0][i].coefficients;
+                    }
+                }
+                filteredSample = lowBuzzFilter[channel][i].processSample(filteredSample);
+                buzzFilterFreq += frequencyID ? 60 : 50;
+            }
+        }
+        
+        previousLowGain = gain;
+        
+        state.previousCorrection = state.correction;
+        state.correction = filteredSample - lowSample;
+    }
+    
+    return delayedSample + correction;
+}
+
+template <typename SampleType>
+void BuzzGate<SampleType>::processLowBandBlock (int channel, const SampleType* input, const SampleType* key,
+                                                SampleType* output, size_t numSamples) noexcept
+{
+    SampleType gains[controlInterval];
+    
+    for (size_t start = 0, length = 0; start < numSamples; start += length)
+    {
+        length = juce::jmin (numSamples - start, detector.getSamplesToNextInterval (channel));
+        this->processDetector (channel, key + start, gains, length);
+        
+        for (size_t i = 0; i < length; ++i)
+            output[start + i] = processLowBand (channel, applyComb (channel, input[start + i], gains[i]), gains[i]);
+    }
+    
+    if (!channel)
+        this->setGainReduction(juce::Decibels::gainToDecibels(detector.getGain (channel)));
+}
+
 template <typename SampleType>
 void BuzzGate<SampleType>::update()
 {
-    threshold = juce::Decibels::decibelsToGain (thresholddB, static_cast<SampleType> (-200.0));
-    thresholdInverse = static_cast<SampleType> (1.0) / threshold;
-    currentRatio = ratio;
+    Gate<SampleType>::update();
     delaySampleDivider = frequencyID ? 120 : 100;
-
-    envelopeFilter.setAttackTime  (attackTime);
-    envelopeFilter.setReleaseTime (releaseTime);
 }
 
 //==============================================================================
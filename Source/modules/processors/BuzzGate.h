@@ -11,90 +11,132 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include "RMSMeters.h"
+#include "Gate.h"
+#include "BiquadCascade.h"
+#include "SVFCascade.h"
 
-// TODO: Make a parent Gate class
 //==============================================================================
 /*
     Dynamic hum canceller that reports RMS attenuation depth. It's a modified juce::NoiseGate class
 */
 template <typename SampleType>
-class BuzzGate  :  public RMSMeters<float>
+class BuzzGate final  :  public Gate<SampleType>
 {
 public:
     BuzzGate();
 //    ~BuzzGate() override;
     
     //==============================================================================
-    /** Sets the threshold in dB of the noise-gate.*/
-    void setThreshold (SampleType newThreshold);
-
-    /** Sets the ratio of the noise-gate (must be higher or equal to 1).*/
-    void setRatio (SampleType newRatio);
-
-    /** Sets the attack time in milliseconds of the noise-gate.*/
-    void setAttack (SampleType newAttack);
-
-    /** Sets the release time in milliseconds of the noise-gate.*/
-    void setRelease (SampleType newRelease);
-    
     /** Sets the frequency ID (0 = 50 Hz, 1 = 60 Hz) of the noise gate.*/
     void setFrequencyID (int newFrequencyID);
+    
+    /** Enables the multirate hum filter. The low band is decimated to a rate
+        independent of the host sample rate, notched there and interpolated back.
+    */
+    void setMultirate (bool shouldUseMultirate);
+    
+    /** Returns the processing delay in samples, non-zero only in multirate mode. */
+    int getLatencyInSamples() const     { return getLatencyInSamples (multirate); }
+    
+    /** Returns the delay the gate has with or without multirate mode, whatever mode it's in. */
+    int getLatencyInSamples (bool withMultirate) const;
 
     //==============================================================================
     /** Initialises the processor. */
-    void prepare (const juce::dsp::ProcessSpec& spec);
+    void prepare (const juce::dsp::ProcessSpec& spec) override;
 
     /** Resets the internal state variables of the processor. */
-    void reset();
+    void reset() override;
 
     //==============================================================================
-    /** Processes the input and output samples supplied in the processing context. */
-    template <typename ProcessContext>
-    void process (const ProcessContext& context) noexcept
+    /** Performs the processing operation on a single sample at a time. */
+    SampleType processSample (int channel, SampleType inputValue)
     {
-        const auto& inputBlock = context.getInputBlock();
-        auto& outputBlock      = context.getOutputBlock();
-        const auto numChannels = outputBlock.getNumChannels();
-        const auto numSamples  = outputBlock.getNumSamples();
-
-        jassert (inputBlock.getNumChannels() == numChannels);
-        jassert (inputBlock.getNumSamples() == numSamples);
-
-        if (context.isBypassed)
-        {
-            outputBlock.copyFrom (inputBlock);
-            return;
-        }
-
-        for (size_t channel = 0; channel < numChannels && channel < 2; ++channel)
-        {
-            auto* inputSamples  = inputBlock .getChannelPointer (channel);
-            auto* outputSamples = outputBlock.getChannelPointer (channel);
-
-            for (size_t i = 0; i < numSamples; ++i)
-                outputSamples[i] = processSample ((int) channel, inputSamples[i]);
-        }
+        return processSample (channel, inputValue, inputValue);
     }
-
-    /** Performs the processing operation on a single sample at a time. */
-    SampleType processSample (int channel, SampleType inputValue);
+    
+    /** Processes a single sample with the detectors keyed from keyValue. */
+    SampleType processSample (int channel, SampleType inputValue, SampleType keyValue);
+    
+    void snapToZero() noexcept override;
 
 private:
     //==============================================================================
-    void update();
+    using Gate<SampleType>::detector;
+    using Gate<SampleType>::referenceEngine;
+    using Gate<SampleType>::sampleRate;
+    using Gate<SampleType>::controlInterval;
+    
+    void update() override;
+    
+    void processGate (const juce::dsp::AudioBlock<const SampleType>& inputBlock,
+                      juce::dsp::AudioBlock<SampleType>& outputBlock) noexcept override;
+    
+    /** Clears the comb and hum filters. */
+    void resetFilters() override;
+    void resetEngineFilters() override;
+    
+    /** Reference engine detectors and comb filter. */
+    SampleType processComb (int channel, SampleType sample, SampleType key, SampleType& gain);
+    SampleType applyComb (int channel, SampleType sample, SampleType gain);
+    
+    /** Fast engine: the hum filters as state variable filters with a fixed frequency and
+        Q, the gain follows the detector every sample without a redesign.
+    */
+    SampleType processCascade (int channel, SampleType sample, SampleType gain);
+    
+    /** Fast engine for a block: per control interval, the detector and comb run per
+        sample and then the hum filters run block-serially over the interval. Intervals
+        at unity gain only feed the delay line and copy the input.
+    */
+    void processCascadeBlock (int channel, const SampleType* input, const SampleType* key,
+                              SampleType* output, size_t numSamples) noexcept;
+    void designHumFilters();
+    void designCascade (BiquadCascade<SampleType, 6>& cascade, double rate, SampleType gain);
+    
+    /** Runs the hum filters on the decimated low band and adds the interpolated correction.
+        The fast engine redesigns them once per low rate sample.
+    */
+    SampleType processLowBand (int channel, SampleType sample, SampleType gain);
+    
+    /** Fast engine in multirate mode: the detector per control interval, then the comb
+        and the low band per sample with the detector's gains.
+    */
+    void processLowBandBlock (int channel, const SampleType* input, const SampleType* key,
+                              SampleType* output, size_t numSamples) noexcept;
+    void resetLowBand();
 
     //==============================================================================
-    SampleType threshold, thresholdInverse, currentRatio;
-    juce::dsp::BallisticsFilter<SampleType> envelopeFilter, RMSFilter;
-    int frequencyID;
+    bool isOpen[2] = { false, false };
+    int frequencyID = 0;
 
-    double sampleRate = 44100.0;
-    SampleType thresholddB = -100, ratio = 10.0, attackTime = 1.0, releaseTime = 100.0,
-                delaySampleDivider = 100, previousGain = 1;
+    SampleType delaySampleDivider = 100, previousGain = 1;
     
     juce::dsp::DelayLine<SampleType> delayLine;
     juce::dsp::IIR::Filter<SampleType> buzzFilter[2][6] ;
+    SVFCascade<SampleType, 6> humFilters;
+    
+    //==============================================================================
+    // Multirate mode: triangular (2nd order boxcar) decimator, hum filters at the
+    // low rate and linear interpolation of the correction signal
+    struct LowBandState
+    {
+        SampleType sum = 0, rampSum = 0, previousRampSum = 0,
+                    correction = 0, previousCorrection = 0;
+        int phase = 0;
+    };
+    
+    static constexpr double lowBandTargetRate = 6000.0;
+    
+    bool multirate = false;
+    int decimationFactor = 1;
+    double lowSampleRate = 6000.0;
+    SampleType decimationGain = 1, previousLowGain = 1;
+    
+    LowBandState lowBandState[2];
+    juce::dsp::IIR::Filter<SampleType> lowBuzzFilter[2][6];
+    BiquadCascade<SampleType, 6> lowBuzzCascade;
+    juce::dsp::DelayLine<SampleType, juce::dsp::DelayLineInterpolationTypes::None> alignmentDelay;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BuzzGate)
 };
@@ -0,0 +1,163 @@
+/*
+  ==============================================================================
+
+    BypassFader.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Crossfade between the dry input and the processed output of a stage when
+    its bypass state changes, instead of switching on a block boundary.
+
+    The stage calls setBypassed() with the bypass flag of every context and
+    pushDry() with every input block. While isBypassed() is true the fade has
+    finished and the stage outputs copyDry() (and keeps whatever it needs
+    warm). While isFading() is true the stage blends the dry input back into
+    its output with mixDry().
+
+    A stage with latency sets it with setLatency(), the dry input is delayed
+    by as much so it lines up with the processed signal during a fade, and the
+    stage keeps its latency while bypassed. The delay is preallocated in
+    prepare() and setMaximumLatency().
+*/
+template <typename SampleType>
+class BypassFader
+{
+public:
+    static constexpr double fadeTimeMs = 5.0;
+
+    //==============================================================================
+    /** Allocates the dry delay for blocks up to spec.maximumBlockSize and sets the fade length. */
+    void prepare (const juce::dsp::ProcessSpec& spec)
+    {
+        jassert (spec.sampleRate > 0);
+
+        step = static_cast<SampleType> (1.0) / static_cast<SampleType> (juce::jmax (1, juce::roundToInt (spec.sampleRate * fadeTimeMs * 0.001)));
+        numChannels = (int) juce::jmin (spec.numChannels, (juce::uint32) 2);
+        maximumBlockSize = juce::jmax (1, (int) spec.maximumBlockSize);
+        setMaximumLatency (0);
+    }
+
+    /** Makes room in the dry delay for latencies up to maxLatency, call it after prepare(). */
+    void setMaximumLatency (int maxLatency)
+    {
+        jassert (maxLatency >= 0);
+
+        dryBuffer.setSize (numChannels, maximumBlockSize + maxLatency);
+        reset();
+    }
+
+    /** Sets the delay of the dry input in samples, it's limited to the maximum latency. */
+    void setLatency (int newLatency) noexcept
+    {
+        jassert (newLatency >= 0);
+        latency = newLatency;
+    }
+
+    /** Jumps to the end of a running fade and clears the dry delay. */
+    void reset() noexcept
+    {
+        mix = target;
+        dryBuffer.clear();
+        writePosition = blockStart = 0;
+    }
+
+    //==============================================================================
+    /** Sets the bypass state for the next block, a change starts a fade. */
+    void setBypassed (bool shouldBeBypassed) noexcept
+    {
+        target = shouldBeBypassed ? static_cast<SampleType> (0.0) : static_cast<SampleType> (1.0);
+    }
+
+    /** Returns true once the stage is fully bypassed. */
+    bool isBypassed() const noexcept    { return mix == static_cast<SampleType> (0.0) && target == static_cast<SampleType> (0.0); }
+
+    /** Returns true while a fade is running. */
+    bool isFading() const noexcept      { return mix != target; }
+
+    //==============================================================================
+    /** Stores the dry input of the channels the stage processes, call it for every block. */
+    void pushDry (const juce::dsp::AudioBlock<const SampleType>& inputBlock) noexcept
+    {
+        auto numSamples = (int) inputBlock.getNumSamples();
+        auto size = dryBuffer.getNumSamples();
+
+        jassert (numSamples <= maximumBlockSize);
+        blockStart = writePosition;
+
+        for (int channel = 0; channel < juce::jmin ((int) inputBlock.getNumChannels(), numChannels); ++channel)
+        {
+            auto* source = inputBlock.getChannelPointer ((size_t) channel);
+            auto firstPart = juce::jmin (numSamples, size - writePosition);
+
+            juce::FloatVectorOperations::copy (dryBuffer.getWritePointer (channel, writePosition), source, firstPart);
+            juce::FloatVectorOperations::copy (dryBuffer.getWritePointer (channel), source + firstPart, numSamples - firstPart);
+        }
+
+        writePosition = (writePosition + numSamples) % size;
+    }
+
+    /** Writes the delayed dry input of the last pushDry() block to the output. */
+    void copyDry (juce::dsp::AudioBlock<SampleType>& outputBlock) noexcept
+    {
+        for (int channel = 0; channel < juce::jmin ((int) outputBlock.getNumChannels(), numChannels); ++channel)
+        {
+            auto* samples = outputBlock.getChannelPointer ((size_t) channel);
+            auto* dry = dryBuffer.getReadPointer (channel);
+            auto position = getReadPosition();
+
+            for (size_t i = 0; i < outputBlock.getNumSamples(); ++i)
+            {
+                samples[i] = dry[position];
+                position = position + 1 < dryBuffer.getNumSamples() ? position + 1 : 0;
+            }
+        }
+    }
+
+    /** Blends the delayed dry input into the processed output and advances the fade. */
+    void mixDry (juce::dsp::AudioBlock<SampleType>& outputBlock) noexcept
+    {
+        auto numSamples = outputBlock.getNumSamples();
+        auto signedStep = target > mix ? step : -step;
+        auto endMix = mix;
+
+        for (int channel = 0; channel < juce::jmin ((int) outputBlock.getNumChannels(), numChannels); ++channel)
+        {
+            auto* dry = dryBuffer.getReadPointer (channel);
+            auto* samples = outputBlock.getChannelPointer ((size_t) channel);
+            auto position = getReadPosition();
+            auto current = mix;
+
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                current = signedStep > 0 ? juce::jmin (current + signedStep, target)
+                                         : juce::jmax (current + signedStep, target);
+                samples[i] = dry[position] + current * (samples[i] - dry[position]);
+                position = position + 1 < dryBuffer.getNumSamples() ? position + 1 : 0;
+            }
+
+            endMix = current;
+        }
+
+        mix = endMix;
+    }
+
+private:
+    //==============================================================================
+    int getReadPosition() const noexcept
+    {
+        auto size = dryBuffer.getNumSamples();
+        return (blockStart - juce::jmin (latency, size - maximumBlockSize) + size) % size;
+    }
+
+    //==============================================================================
+    juce::AudioBuffer<SampleType> dryBuffer;
+    int numChannels = 0, maximumBlockSize = 0, latency = 0, writePosition = 0, blockStart = 0;
+    SampleType mix = 1, target = 1, step = 1;
+};
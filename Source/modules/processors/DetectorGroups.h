@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+    DetectorGroups.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Process-wide slots through which plugin instances share their detector
+    envelopes, held with a juce::SharedResourcePointer so every instance in the
+    host process sees the same groups. One instance per group publishes the
+    envelopes of each block, the other members read them instead of running
+    their own detectors.
+
+    Every slot is a seqlock: the publisher makes the sequence odd, writes the
+    values and makes it even again, a reader retries when the sequence was odd
+    or changed under it, a few times at most. Neither side locks or allocates, so both run on the
+    audio threads. A publisher that stops writing loses its group after a
+    timeout and any other instance may claim it.
+*/
+class DetectorGroups
+{
+public:
+    static constexpr int numGroups = 8;
+    static constexpr int maxEnvelopes = 16;
+
+    /** A publisher silent for longer than this is considered gone. */
+    static constexpr juce::uint32 timeoutMs = 500;
+
+    //==============================================================================
+    /** Writes the envelopes of a group, claiming it when it has no live publisher.
+        Returns false when another instance owns the group.
+    */
+    bool publish (int group, const void* publisher, const float* envelopes, int numEnvelopes) noexcept
+    {
+        jassert (juce::isPositiveAndBelow (group, numGroups));
+        jassert (numEnvelopes <= maxEnvelopes);
+
+        auto& slot = slots[group];
+        auto now = juce::Time::getMillisecondCounter();
+        auto* owner = slot.publisher.load (std::memory_order_acquire);
+
+        if (owner != publisher)
+        {
+            if (owner != nullptr && now - slot.publishTime.load (std::memory_order_relaxed) < timeoutMs)
+                return false;
+
+            if (! slot.publisher.compare_exchange_strong (owner, publisher, std::memory_order_acq_rel))
+                return false;
+        }
+
+        auto sequence = slot.sequence.load (std::memory_order_relaxed);
+        slot.sequence.store (sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+
+        for (int i = 0; i < numEnvelopes; ++i)
+            slot.envelopes[i].store (envelopes[i], std::memory_order_relaxed);
+
+        slot.sequence.store (sequence + 2, std::memory_order_release);
+        slot.publishTime.store (now, std::memory_order_relaxed);
+        return true;
+    }
+
+    /** Copies the latest envelopes of a group published by another instance.
+        Returns false when the group has no live publisher, or when the publisher
+        kept writing during every attempt. The envelopes are left as they were then,
+        and the caller runs its own detectors for the block.
+    */
+    bool read (int group, const void* subscriber, float* envelopes, int numEnvelopes) const noexcept
+    {
+        jassert (juce::isPositiveAndBelow (group, numGroups));
+        jassert (numEnvelopes <= maxEnvelopes);
+
+        auto& slot = slots[group];
+        auto* owner = slot.publisher.load (std::memory_order_acquire);
+
+        if (owner == nullptr || owner == subscriber
+         || juce::Time::getMillisecondCounter() - slot.publishTime.load (std::memory_order_relaxed) >= timeoutMs)
+            return false;
+
+        float values[maxEnvelopes];
+
+        for (int attempt = 0; attempt < maxAttempts; ++attempt)
+        {
+            auto sequence = slot.sequence.load (std::memory_order_acquire);
+
+            if ((sequence & 1) != 0)
+                continue;
+
+            for (int i = 0; i < numEnvelopes; ++i)
+                values[i] = slot.envelopes[i].load (std::memory_order_relaxed);
+
+            std::atomic_thread_fence (std::memory_order_acquire);
+
+            if (slot.sequence.load (std::memory_order_relaxed) == sequence)
+            {
+                std::copy (values, values + numEnvelopes, envelopes);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /** Gives up a group so another instance can publish to it straight away. */
+    void release (int group, const void* publisher) noexcept
+    {
+        jassert (juce::isPositiveAndBelow (group, numGroups));
+
+        auto* owner = publisher;
+        slots[group].publisher.compare_exchange_strong (owner, nullptr, std::memory_order_acq_rel);
+    }
+
+private:
+    //==============================================================================
+    static constexpr int maxAttempts = 4;
+
+    // Own cache line each, so publishers of different groups don't contend
+    struct alignas (64) Slot
+    {
+        std::atomic<const void*> publisher { nullptr };
+        std::atomic<juce::uint32> sequence { 0 }, publishTime { 0 };
+        std::atomic<float> envelopes[maxEnvelopes] {};
+    };
+
+    Slot slots[numGroups];
+};
@@ -0,0 +1,428 @@
+/*
+  ==============================================================================
+
+    Gate.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RMSMeters.h"
+#include "SquareLawDetector.h"
+#include "BypassFader.h"
+
+//==============================================================================
+/*
+    Parent of the gates of the chain, everything they share: the threshold,
+    ratio and ballistics, both detector engines, the external envelopes of a
+    detector group, the sidechain key, the bypass fade and the grid the states
+    snap to zero on.
+
+    process() runs the bypass fade and the envelope ramps around processGate(),
+    the part each gate implements, skip() runs only the detectors.
+*/
+template <typename SampleType>
+class Gate  :  public RMSMeters<float>
+{
+public:
+    /** minGaindB is the deepest the gate cuts, both engines stop there. */
+    explicit Gate (SampleType minGaindB) : minGaindB (minGaindB)
+    {
+        RMSFilter.setLevelCalculationType (juce::dsp::BallisticsFilterLevelCalculationType::RMS);
+        RMSFilter.setAttackTime  (static_cast<SampleType> (0.0));
+        RMSFilter.setReleaseTime (static_cast<SampleType> (50.0));
+    }
+
+    virtual ~Gate() = default;
+
+    //==============================================================================
+    /** Sets the threshold in dB of the noise-gate.*/
+    void setThreshold (SampleType newThreshold)
+    {
+        thresholddB = newThreshold;
+        update();
+    }
+
+    /** Sets the ratio of the noise-gate (must be higher or equal to 1).*/
+    void setRatio (SampleType newRatio)
+    {
+        jassert (newRatio >= static_cast<SampleType> (1.0));
+
+        ratio = newRatio;
+        update();
+    }
+
+    /** Sets the attack time in milliseconds of the noise-gate.*/
+    void setAttack (SampleType newAttack)
+    {
+        attackTime = newAttack;
+        update();
+    }
+
+    /** Sets the release time in milliseconds of the noise-gate.*/
+    void setRelease (SampleType newRelease)
+    {
+        releaseTime = newRelease;
+        update();
+    }
+
+    /** Switches to the reference engine, the juce::NoiseGate detector and gain law on every
+        sample with the filters redesigned whenever the gain moves, the way the stages always
+        ran. The fast engine runs the square law detector once per control interval and keeps
+        the filters fixed, moving only their gain. Both stay available so they can be
+        null-tested against each other.
+    */
+    void setReferenceEngine (bool shouldUseReference)
+    {
+        if (referenceEngine == shouldUseReference)
+            return;
+
+        // The engines keep separate filters, start the new one from a clean state
+        referenceEngine = shouldUseReference;
+        resetEngineFilters();
+    }
+
+    /** Keys the detectors from an external signal for the next process() call.
+        Channels missing from the block (or an empty block) key from the input.
+    */
+    void setSidechain (const juce::dsp::AudioBlock<const SampleType>& newKeyBlock)
+    {
+        keyBlock = newKeyBlock;
+    }
+
+    /** Returns the detector envelope at the end of the last processed block. */
+    SampleType getEnvelope (int channel) const noexcept     { return envelope[channel]; }
+
+    /** Replaces the detectors of a channel with an envelope computed elsewhere, e.g. by
+        another instance of a detector group, until clearExternalEnvelope(). The envelope
+        ramps linearly from its current value to the new one over the next rampLength
+        samples, however many process() calls they are split into, and holds there.
+    */
+    void setExternalEnvelope (int channel, SampleType newEnvelope, size_t rampLength) noexcept
+    {
+        externalEnvelope[channel].start (envelope[channel], newEnvelope, rampLength);
+        hasExternalEnvelope = true;
+    }
+
+    /** Goes back to the stage's own detectors. */
+    virtual void clearExternalEnvelope() noexcept           { hasExternalEnvelope = false; }
+
+    //==============================================================================
+    /** Initialises the processor. */
+    virtual void prepare (const juce::dsp::ProcessSpec& spec)
+    {
+        jassert (spec.sampleRate > 0);
+        jassert (spec.numChannels > 0);
+
+        sampleRate = spec.sampleRate;
+
+        RMSFilter.prepare (spec);
+        envelopeFilter.prepare (spec);
+        detector.prepare (sampleRate);
+        bypassFader.prepare (spec);
+        snapInterval = juce::jmax ((size_t) spec.maximumBlockSize, (size_t) 1);
+    }
+
+    /** Resets the internal state variables of the processor. */
+    virtual void reset()
+    {
+        RMSFilter.reset();
+        envelopeFilter.reset();
+        detector.reset();
+        bypassFader.reset();
+        samplesSinceSnap = 0;
+        filtersStale = false;
+        rmsPeak = 0;
+        envelope[0] = envelope[1] = 0;
+    }
+
+    //==============================================================================
+    /** Processes the input and output samples supplied in the processing context. */
+    template <typename ProcessContext>
+    void process (const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock      = context.getOutputBlock();
+        const auto numSamples  = outputBlock.getNumSamples();
+
+        jassert (inputBlock.getNumChannels() == outputBlock.getNumChannels());
+        jassert (inputBlock.getNumSamples() == numSamples);
+
+        const auto isSnapDue = advanceSnapGrid (numSamples);
+
+        // Bypass fades over a few ms, once it's complete only the detectors keep running.
+        // The dry signal is delayed by the latency of the stage, which stays the same
+        auto wasBypassed = bypassFader.isBypassed();
+        bypassFader.setBypassed (context.isBypassed);
+        bypassFader.pushDry (inputBlock);
+
+        if (bypassFader.isBypassed())
+        {
+            trackEnvelopes (inputBlock, numSamples);
+            outputBlock.copyFrom (inputBlock);
+            bypassFader.copyDry (outputBlock);
+            return;
+        }
+
+        if (wasBypassed || filtersStale)
+            resetFilters();
+
+        filtersStale = false;
+
+        processGate (inputBlock, outputBlock);
+
+        if (bypassFader.isFading())
+            bypassFader.mixDry (outputBlock);
+
+        if (isSnapDue)
+            snapToZero();
+    }
+
+    /** Runs only the detectors on a block whose output isn't needed, while the processor
+        skips the chain. The filters of the signal path start from silence in the next
+        process() call, like after a bypass.
+    */
+    template <typename ProcessContext>
+    void skip (const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        const auto numSamples  = inputBlock.getNumSamples();
+
+        const auto isSnapDue = advanceSnapGrid (numSamples);
+
+        // There's no output to fade, a running bypass fade jumps to its end
+        bypassFader.setBypassed (context.isBypassed);
+        bypassFader.reset();
+        bypassFader.pushDry (inputBlock);
+
+        trackEnvelopes (inputBlock, numSamples);
+        filtersStale = true;
+
+        if (isSnapDue)
+            snapToZero();
+    }
+
+    /** Rounds decaying filter and envelope states to zero before they become denormals.
+        Called by process() whenever the blocks complete maximumBlockSize samples, so the
+        states round at the same samples for any block sizes. Call it yourself when
+        processing sample by sample.
+    */
+    virtual void snapToZero() noexcept
+    {
+        // The RMS filter holds a mean square that snapToZero() would cut at -80 dB,
+        // it is cleared only once its level has decayed far below anything audible
+        if (rmsPeak < rmsFloor)
+            RMSFilter.reset();
+
+        rmsPeak = 0;
+        envelopeFilter.snapToZero();
+        detector.snapToZero();
+        juce::dsp::util::snapToZero (envelope[0]);
+        juce::dsp::util::snapToZero (envelope[1]);
+    }
+
+protected:
+    //==============================================================================
+    /** Processes a block that isn't bypassed. */
+    virtual void processGate (const juce::dsp::AudioBlock<const SampleType>& inputBlock,
+                              juce::dsp::AudioBlock<SampleType>& outputBlock) noexcept = 0;
+
+    /** Clears the filters of the signal path, their state is stale after a bypass. */
+    virtual void resetFilters() = 0;
+
+    /** Clears the filters that only one of the engines runs. */
+    virtual void resetEngineFilters() {}
+
+    /** Applies the settings, gates with their own derived values add them here. */
+    virtual void update()
+    {
+        threshold = juce::Decibels::decibelsToGain (thresholddB, static_cast<SampleType> (-200.0));
+        thresholdInverse = static_cast<SampleType> (1.0) / threshold;
+        currentRatio = ratio;
+        minGain = juce::Decibels::decibelsToGain (minGaindB);
+
+        envelopeFilter.setAttackTime  (attackTime);
+        envelopeFilter.setReleaseTime (releaseTime);
+
+        detector.setTimes (attackTime, releaseTime);
+        detector.setThreshold (thresholddB, ratio, minGaindB);
+    }
+
+    //==============================================================================
+    /** Advances the grid of maximumBlockSize samples that process() rounds the states on,
+        returns true if the block reaches the end of an interval.
+    */
+    bool advanceSnapGrid (size_t numSamples) noexcept
+    {
+        samplesSinceSnap += numSamples;
+
+        if (samplesSinceSnap < snapInterval)
+            return false;
+
+        samplesSinceSnap %= snapInterval;
+        return true;
+    }
+
+    const SampleType* getKeySamples (size_t channel, const SampleType* inputSamples, size_t numSamples) const noexcept
+    {
+        if (channel >= keyBlock.getNumChannels())
+            return inputSamples;
+
+        jassert (keyBlock.getNumSamples() >= numSamples);
+        juce::ignoreUnused (numSamples);
+        return keyBlock.getChannelPointer (channel);
+    }
+
+    /** Linear ramp of an external envelope, it carries over between process() calls. */
+    struct EnvelopeRamp
+    {
+        void start (SampleType current, SampleType newTarget, size_t length) noexcept
+        {
+            target = newTarget;
+            remaining = juce::jmax (length, (size_t) 1);
+            step = (target - current) / static_cast<SampleType> (remaining);
+        }
+
+        /** Returns the envelope numSamples after current. */
+        SampleType advance (SampleType current, size_t numSamples) noexcept
+        {
+            auto length = juce::jmin (numSamples, remaining);
+            remaining -= length;
+
+            // Lands exactly on the target whatever the rounding of the steps
+            return remaining > 0 ? current + step * static_cast<SampleType> (length) : target;
+        }
+
+        SampleType target = 0, step = 0;
+        size_t remaining = 0;
+    };
+
+    SampleType advanceExternalEnvelope (int channel, size_t numSamples) noexcept
+    {
+        envelope[channel] = externalEnvelope[channel].advance (envelope[channel], numSamples);
+        return envelope[channel];
+    }
+
+    //==============================================================================
+    /** Reference engine: runs the RMS and ballistics filters on the key, or steps the
+        external envelope. Channels above the second have no external envelope.
+    */
+    SampleType processEnvelope (int channel, SampleType key)
+    {
+        if (hasExternalEnvelope && channel < 2)
+        {
+            auto env = advanceExternalEnvelope (channel, 1);
+
+            if (!channel)
+                this->setInputRMS(float(env));
+
+            return env;
+        }
+
+        // RMS ballistics filter
+        auto env = RMSFilter.processSample (channel, key);
+        rmsPeak = std::max (rmsPeak, env);
+
+        if (!channel)
+            this->setInputRMS(float(env));
+
+        // Ballistics filter
+        env = envelopeFilter.processSample (channel, env);
+
+        if (channel < 2)
+            envelope[channel] = env;
+
+        return env;
+    }
+
+    /** Reference engine: processEnvelope() and the gain law of juce::NoiseGate, limited to minGaindB.
+        Like the fast engine's, gains at or below SquareLawDetector::silenceDecibels are 0.
+    */
+    SampleType processGain (int channel, SampleType key)
+    {
+        auto env = processEnvelope (channel, key);
+
+        auto gain = (env > threshold) ? static_cast<SampleType> (1.0)
+                                      : std::pow (env * thresholdInverse, currentRatio - static_cast<SampleType> (1.0));
+
+        gain = std::max (gain, minGain);
+        return gain <= silenceGain ? static_cast<SampleType> (0) : gain;
+    }
+
+    /** Fast engine: square law detector, or the external envelope, over a block. Blocks
+        split where detector.getSamplesToNextInterval() ends keep one gain ramp each, so
+        the isUnityGain() decision is the same for any block size.
+    */
+    void processDetector (int channel, const SampleType* key, SampleType* gains, size_t numSamples) noexcept
+    {
+        if (hasExternalEnvelope)
+        {
+            auto env = advanceExternalEnvelope (channel, numSamples);
+            detector.processExternal (channel, env * env, gains, numSamples);
+        }
+        else
+        {
+            detector.process (channel, key, gains, numSamples);
+            envelope[channel] = std::sqrt (detector.getMeanSquare (channel));
+        }
+
+        if (!channel)
+            this->setInputRMS(float(std::sqrt (detector.getInputMeanSquare (channel))));
+    }
+
+    /** While bypassed, keeps the detectors of the active engine following the key. */
+    virtual void trackEnvelopes (const juce::dsp::AudioBlock<const SampleType>& inputBlock, size_t numSamples) noexcept
+    {
+        for (size_t channel = 0; channel < inputBlock.getNumChannels() && channel < 2; ++channel)
+            trackEnvelope ((int) channel, getKeySamples (channel, inputBlock.getChannelPointer (channel), numSamples), numSamples);
+    }
+
+    void trackEnvelope (int channel, const SampleType* key, size_t numSamples) noexcept
+    {
+        if (referenceEngine)
+        {
+            for (size_t i = 0; i < numSamples; ++i)
+                processEnvelope (channel, key[i]);
+
+            return;
+        }
+
+        if (hasExternalEnvelope)
+        {
+            auto env = advanceExternalEnvelope (channel, numSamples);
+            detector.setMeanSquare (channel, env * env);
+            return;
+        }
+
+        detector.track (channel, key, numSamples);
+        envelope[channel] = std::sqrt (detector.getMeanSquare (channel));
+    }
+
+    //==============================================================================
+    static constexpr size_t controlInterval = SquareLawDetector<SampleType>::controlInterval;
+    static constexpr SampleType silenceGain = static_cast<SampleType> (1.0e-7);    // SquareLawDetector::silenceDecibels
+
+    const SampleType minGaindB;
+    SampleType threshold, thresholdInverse, currentRatio, minGain = 0;
+    juce::dsp::BallisticsFilter<SampleType> envelopeFilter, RMSFilter;
+    SquareLawDetector<SampleType> detector;
+    BypassFader<SampleType> bypassFader;
+    juce::dsp::AudioBlock<const SampleType> keyBlock;
+
+    SampleType envelope[2] = { 0, 0 };
+    EnvelopeRamp externalEnvelope[2];
+    bool hasExternalEnvelope = false, referenceEngine = false, filtersStale = false;
+    size_t snapInterval = 1, samplesSinceSnap = 0;
+
+    // Highest RMS level since the last snap, about -300 dB is where the RMS filter gets cleared
+    SampleType rmsPeak = 0;
+    static constexpr SampleType rmsFloor = static_cast<SampleType> (1.0e-15);
+
+    double sampleRate = 44100.0;
+    SampleType thresholddB = -100, ratio = 10.0, attackTime = 1.0, releaseTime = 100.0;
+
+private:
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Gate)
+};
@@ -13,50 +13,39 @@
 #include "HissGate.h"
 
 template <typename SampleType>
-HissGate<SampleType>::HissGate()
+HissGate<SampleType>::HissGate() : Gate<SampleType> (static_cast<SampleType> (-24.0))
 {
     update();
-
-    RMSFilter.setLevelCalculationType (juce::dsp::BallisticsFilterLevelCalculationType::RMS);
-    RMSFilter.setAttackTime  (static_cast<SampleType> (0.0));
-    RMSFilter.setReleaseTime (static_cast<SampleType> (50.0));
-}
-
-template <typename SampleType>
-void HissGate<SampleType>::setThreshold (SampleType newValue)
-{
-    thresholddB = newValue;
-    update();
-}
-
-template <typename SampleType>
-void HissGate<SampleType>::setRatio (SampleType newRatio)
-{
-    jassert (newRatio >= static_cast<SampleType> (1.0));
-
-    ratio = newRatio;
-    update();
 }
 
 template <typename SampleType>
-void HissGate<SampleType>::setAttack (SampleType newAttack)
+void HissGate<SampleType>::setCutoff (float newCutoff)
 {
-    attackTime = newAttack;
+    frequency = newCutoff;
     update();
 }
 
 template <typename SampleType>
-void HissGate<SampleType>::setRelease (SampleType newRelease)
+void HissGate<SampleType>::setOversampling (int newOversamplingIndex)
 {
-    releaseTime = newRelease;
+    jassert (newOversamplingIndex >= 0 && newOversamplingIndex <= 2);
+    
+    if (oversamplingIndex == newOversamplingIndex)
+        return;
+    
+    oversamplingIndex = newOversamplingIndex;
     update();
+    resetFilters();
+    this->bypassFader.setLatency (getLatencyInSamples());
 }
 
 template <typename SampleType>
-void HissGate<SampleType>::setCutoff (float newCutoff)
+int HissGate<SampleType>::getLatencyInSamples (int withOversamplingIndex) const
 {
-    frequency = newCutoff;
-    update();
+    if (withOversamplingIndex == 0 || oversamplers[withOversamplingIndex - 1] == nullptr)
+        return 0;
+    
+    return juce::roundToInt (oversamplers[withOversamplingIndex - 1]->getLatencyInSamples());
 }
 
 template <typename SampleType>
@@ -69,18 +58,25 @@ float HissGate<SampleType>::getCurrentGain ()
 template <typename SampleType>
 void HissGate<SampleType>::prepare (const juce::dsp::ProcessSpec& spec)
 {
-    jassert (spec.sampleRate > 0);
-    jassert (spec.numChannels > 0);
-
-    sampleRate = spec.sampleRate;
-
-    RMSFilter.prepare (spec);
-    envelopeFilter.prepare (spec);
+    Gate<SampleType>::prepare (spec);
     
-    for (int channel = 0; channel < 2 && channel; channel++) {
-        *hissFilter[channel].coefficients = juce::dsp::IIR::ArrayCoefficients<SampleType>::makeHighShelf(sampleRate, frequency, 1, 1);
+    for (int channel = 0; channel < 2; channel++) {
         hissFilter[channel].prepare (spec);
+        detectorGains[channel].resize (juce::jmax (spec.maximumBlockSize, (juce::uint32) 1));
     }
+    
+    for (size_t i = 0; i < 2; i++) {
+        oversamplers[i] = std::make_unique<juce::dsp::Oversampling<SampleType>> (spec.numChannels, i + 1,
+                              juce::dsp::Oversampling<SampleType>::filterHalfBandPolyphaseIIR, true, true);
+        oversamplers[i]->initProcessing (spec.maximumBlockSize);
+    }
+    
+    this->bypassFader.setMaximumLatency (juce::jmax (juce::roundToInt (oversamplers[0]->getLatencyInSamples()),
+                                                     juce::roundToInt (oversamplers[1]->getLatencyInSamples())));
+    this->bypassFader.setLatency (getLatencyInSamples());
+    
+    // Filters start at order 1, assign the shelf here so the audio thread never reallocates its state
+    resetFilters();
 
     update();
     reset();
@@ -89,32 +85,99 @@ void HissGate<SampleType>::prepare (const juce::dsp::ProcessSpec& spec)
 template <typename SampleType>
 void HissGate<SampleType>::reset()
 {
-    RMSFilter.reset();
-    envelopeFilter.reset();
-    for (int channel = 0; channel < 2 && channel; channel++) {
+    Gate<SampleType>::reset();
+    isOpen[0] = isOpen[1] = false;
+    for (int channel = 0; channel < 2; channel++) {
         hissFilter[channel].reset();
     }
+    
+    shelf.reset();
+    oversampledShelf.reset();
+    
+    for (auto& oversampling : oversamplers)
+        if (oversampling != nullptr)
+            oversampling->reset();
 }
 
-//==============================================================================
 template <typename SampleType>
-SampleType HissGate<SampleType>::processSample (int channel, SampleType sample)
+void HissGate<SampleType>::resetFilters()
 {
-    SampleType modifiedSample = sample;
+    auto rate = sampleRate * (1 << oversamplingIndex);
     
-    // RMS ballistics filter
-    auto env = RMSFilter.processSample (channel, sample);
+    for (int channel = 0; channel < 2; channel++) {
+        *hissFilter[channel].coefficients = juce::dsp::IIR::ArrayCoefficients<SampleType>::makeHighShelf(rate, frequency, 1, 1);
+        hissFilter[channel].reset();
+        oversampledGain[channel] = 1;
+    }
     
-    if (!channel)
-        this->setInputRMS(float(env));
-    // Ballistics filter
-    env = envelopeFilter.processSample (channel, env);
+    shelf.reset();
+    oversampledShelf.reset();
+    isOpen[0] = isOpen[1] = false;
+    previousGain = 1;
+    
+    if (oversamplingIndex > 0 && oversamplers[oversamplingIndex - 1] != nullptr)
+        oversamplers[oversamplingIndex - 1]->reset();
+}
+
+template <typename SampleType>
+void HissGate<SampleType>::snapToZero() noexcept
+{
+    Gate<SampleType>::snapToZero();
+    
+    for (int channel = 0; channel < 2; channel++)
+        hissFilter[channel].snapToZero();
     
-    auto gain = (env > threshold) ? static_cast<SampleType> (1.0)
-                                  : std::pow (env * thresholdInverse, currentRatio - static_cast<SampleType> (1.0));
+    shelf.snapToZero();
+    oversampledShelf.snapToZero();
+}
 
-    auto minGain = juce::Decibels::decibelsToGain(static_cast<SampleType> (-24.0));
-    auto filterGain = gain > minGain ? gain : minGain;
+//==============================================================================
+template <typename SampleType>
+void HissGate<SampleType>::processGate (const juce::dsp::AudioBlock<const SampleType>& inputBlock,
+                                        juce::dsp::AudioBlock<SampleType>& outputBlock) noexcept
+{
+    if (oversamplingIndex > 0)
+    {
+        processOversampled (inputBlock, outputBlock);
+        return;
+    }
+    
+    const auto numChannels = outputBlock.getNumChannels();
+    const auto numSamples  = outputBlock.getNumSamples();
+
+    for (size_t channel = 0; channel < numChannels && channel < 2; ++channel)
+    {
+        auto* inputSamples  = inputBlock .getChannelPointer (channel);
+        auto* outputSamples = outputBlock.getChannelPointer (channel);
+        auto* keySamples    = this->getKeySamples (channel, inputSamples, numSamples);
+        
+        if (! referenceEngine)
+        {
+            processCascadeBlock ((int) channel, inputSamples, keySamples, outputSamples, numSamples);
+            continue;
+        }
+
+        for (size_t i = 0; i < numSamples; ++i)
+            outputSamples[i] = processSample ((int) channel, inputSamples[i], keySamples[i]);
+    }
+}
+
+template <typename SampleType>
+SampleType HissGate<SampleType>::processSample (int channel, SampleType sample, SampleType key)
+{
+    SampleType modifiedSample = sample;
+    auto filterGain = this->processGain (channel, key);
+    
+    if (! referenceEngine)
+    {
+        if (filterGain != previousGain && !channel)
+        {
+            currentGain.set(float(filterGain));
+            previousGain = filterGain;
+        }
+        
+        return shelf.processHighShelf (channel, modifiedSample, filterGain);
+    }
     
     if (filterGain != previousGain)
     {
@@ -136,14 +199,123 @@ SampleType HissGate<SampleType>::processSample (int channel, SampleType sample)
 }
 
 template <typename SampleType>
-void HissGate<SampleType>::update()
+void HissGate<SampleType>::processCascadeBlock (int channel, const SampleType* input, const SampleType* key,
+                                                SampleType* output, size_t numSamples) noexcept
+{
+    SampleType gains[controlInterval];
+    
+    for (size_t start = 0, length = 0; start < numSamples; start += length)
+    {
+        length = juce::jmin (numSamples - start, detector.getSamplesToNextInterval (channel));
+        
+        auto isUnity = detector.isUnityGain (channel);
+        this->processDetector (channel, key + start, gains, length);
+        
+        for (size_t i = 0; i < length; ++i)
+            output[start + i] = input[start + i];
+        
+        // The shelf is identity, it restarts from silence and fades in with the gain
+        if (isUnity)
+        {
+            if (! isOpen[channel])
+                shelf.reset (channel);
+            
+            isOpen[channel] = true;
+            continue;
+        }
+        
+        isOpen[channel] = false;
+        shelf.processHighShelf (channel, output + start, gains, length);
+    }
+    
+    if (!channel)
+        currentGain.set(float(detector.getGain (channel)));
+}
+
+template <typename SampleType>
+void HissGate<SampleType>::processOversampled (const juce::dsp::AudioBlock<const SampleType>& inputBlock,
+                                               juce::dsp::AudioBlock<SampleType>& outputBlock) noexcept
 {
-    threshold = juce::Decibels::decibelsToGain (thresholddB, static_cast<SampleType> (-200.0));
-    thresholdInverse = static_cast<SampleType> (1.0) / threshold;
-    currentRatio = ratio;
+    auto& oversampling = *oversamplers[oversamplingIndex - 1];
+    const auto factor = oversampling.getOversamplingFactor();
+    const auto oversampledRate = sampleRate * (double) factor;
+    const auto numChannels = juce::jmin (outputBlock.getNumChannels(), (size_t) 2);
+    const auto numSamples = outputBlock.getNumSamples();
+    const auto maxChunkSize = detectorGains[0].size();
+    
+    for (size_t offset = 0; offset < numSamples; offset += maxChunkSize)
+    {
+        auto chunkSize = juce::jmin (maxChunkSize, numSamples - offset);
+        auto inputChunk = inputBlock.getSubBlock (offset, chunkSize);
+        auto outputChunk = outputBlock.getSubBlock (offset, chunkSize);
+        
+        for (size_t channel = 0; channel < numChannels; ++channel)
+        {
+            auto* keySamples = this->getKeySamples (channel, inputBlock.getChannelPointer (channel), numSamples) + offset;
+            auto* gains = detectorGains[channel].data();
+            
+            if (! referenceEngine)
+            {
+                this->processDetector ((int) channel, keySamples, gains, chunkSize);
+                continue;
+            }
+            
+            for (size_t i = 0; i < chunkSize; ++i)
+                gains[i] = this->processGain ((int) channel, keySamples[i]);
+        }
+        
+        auto oversampledBlock = oversampling.processSamplesUp (inputChunk);
+        
+        // The gain ramps linearly between the base rate values, so it moves smoothly
+        // at the oversampled rate instead of stepping once per base sample
+        for (size_t channel = 0; channel < numChannels; ++channel)
+        {
+            auto* samples = oversampledBlock.getChannelPointer (channel);
+            auto* gains = detectorGains[channel].data();
+            auto& gain = oversampledGain[channel];
+            
+            for (size_t i = 0; i < chunkSize; ++i)
+            {
+                auto step = (gains[i] - gain) / static_cast<SampleType> (factor);
+                
+                for (size_t k = 0; k < factor; ++k, ++samples)
+                {
+                    if (! referenceEngine)
+                    {
+                        gain += step;
+                        *samples = oversampledShelf.processHighShelf ((int) channel, *samples, gain);
+                        continue;
+                    }
+                    
+                    if (step != static_cast<SampleType> (0.0))
+                    {
+                        gain += step;
+                        *hissFilter[channel].coefficients = juce::dsp::IIR::ArrayCoefficients<SampleType>::
+                                                            makeHighShelf(oversampledRate, frequency, 1, gain);
+                    }
+                    
+                    *samples = hissFilter[channel].processSample (*samples);
+                }
+                
+                gain = gains[i];
+            }
+        }
+        
+        oversampling.processSamplesDown (outputChunk);
+    }
+    
+    currentGain.set (float (oversampledGain[0]));
+}
 
-    envelopeFilter.setAttackTime  (attackTime);
-    envelopeFilter.setReleaseTime (releaseTime);
+template <typename SampleType>
+void HissGate<SampleType>::update()
+{
+    Gate<SampleType>::update();
+    
+    shelf.setStage (0, sampleRate, frequency, 1);
+    
+    if (oversamplingIndex > 0)
+        oversampledShelf.setStage (0, sampleRate * (1 << oversamplingIndex), frequency, 1);
 }
 
 //==============================================================================
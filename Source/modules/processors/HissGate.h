@@ -11,90 +11,95 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include "RMSMeters.h"
+#include "Gate.h"
+#include "SVFCascade.h"
 
-// TODO: Make a parent Gate class
 //==============================================================================
 /*
     A dynamic shelving filter that cuts high frequency and reports attenuation depth
 */
 template <typename SampleType>
-class HissGate  :  public RMSMeters<SampleType>
+class HissGate final  :  public Gate<SampleType>
 {
 public:
     HissGate();
 //    ~HissGate() override;
     
     //==============================================================================
-    /** Sets the threshold in dB of the noise-gate.*/
-    void setThreshold (SampleType newThreshold);
-
-    /** Sets the ratio of the noise-gate (must be higher or equal to 1).*/
-    void setRatio (SampleType newRatio);
-
-    /** Sets the attack time in milliseconds of the noise-gate.*/
-    void setAttack (SampleType newAttack);
-
-    /** Sets the release time in milliseconds of the noise-gate.*/
-    void setRelease (SampleType newRelease);
-    
     void setCutoff (float newCutoff);
     
+    /** Runs the gain-modulated shelf 2x (1) or 4x (2) oversampled, 0 runs it at the
+        base rate. The detectors always stay at the base rate.
+    */
+    void setOversampling (int newOversamplingIndex);
+    
+    /** Returns the delay of the oversampling filters in samples. */
+    int getLatencyInSamples() const     { return getLatencyInSamples (oversamplingIndex); }
+    
+    /** Returns the delay the gate has at an oversampling index, whatever index it's set to. */
+    int getLatencyInSamples (int withOversamplingIndex) const;
+    
     float getCurrentGain();
 
     //==============================================================================
     /** Initialises the processor. */
-    void prepare (const juce::dsp::ProcessSpec& spec);
+    void prepare (const juce::dsp::ProcessSpec& spec) override;
 
     /** Resets the internal state variables of the processor. */
-    void reset();
+    void reset() override;
 
     //==============================================================================
-    /** Processes the input and output samples supplied in the processing context. */
-    template <typename ProcessContext>
-    void process (const ProcessContext& context) noexcept
+    /** Performs the processing operation on a single sample at a time. */
+    SampleType processSample (int channel, SampleType inputValue)
     {
-        const auto& inputBlock = context.getInputBlock();
-        auto& outputBlock      = context.getOutputBlock();
-        const auto numChannels = outputBlock.getNumChannels();
-        const auto numSamples  = outputBlock.getNumSamples();
-
-        jassert (inputBlock.getNumChannels() == numChannels);
-        jassert (inputBlock.getNumSamples() == numSamples);
-
-        if (context.isBypassed)
-        {
-            outputBlock.copyFrom (inputBlock);
-            return;
-        }
-
-        for (size_t channel = 0; channel < numChannels && channel < 2; ++channel)
-        {
-            auto* inputSamples  = inputBlock .getChannelPointer (channel);
-            auto* outputSamples = outputBlock.getChannelPointer (channel);
-
-            for (size_t i = 0; i < numSamples; ++i)
-                outputSamples[i] = processSample ((int) channel, inputSamples[i]);
-        }
+        return processSample (channel, inputValue, inputValue);
     }
-
-    /** Performs the processing operation on a single sample at a time. */
-    SampleType processSample (int channel, SampleType inputValue);
+    
+    /** Processes a single sample with the detectors keyed from keyValue. */
+    SampleType processSample (int channel, SampleType inputValue, SampleType keyValue);
+    
+    void snapToZero() noexcept override;
 
 private:
     //==============================================================================
-    void update();
+    using Gate<SampleType>::detector;
+    using Gate<SampleType>::referenceEngine;
+    using Gate<SampleType>::sampleRate;
+    using Gate<SampleType>::controlInterval;
+    
+    void update() override;
+    
+    void processGate (const juce::dsp::AudioBlock<const SampleType>& inputBlock,
+                      juce::dsp::AudioBlock<SampleType>& outputBlock) noexcept override;
+    
+    /** Clears the shelf and the oversampling filters. */
+    void resetFilters() override;
+    void resetEngineFilters() override      { resetFilters(); }
+    
+    /** Fast engine for a block: per control interval, the detector runs per sample and
+        then the shelf runs block-serially over the interval with the gains it produced.
+        Intervals at unity gain copy the input.
+    */
+    void processCascadeBlock (int channel, const SampleType* input, const SampleType* key,
+                              SampleType* output, size_t numSamples) noexcept;
+    
+    /** Detectors at the base rate, shelf and its gain ramps at the oversampled rate. */
+    void processOversampled (const juce::dsp::AudioBlock<const SampleType>& inputBlock,
+                             juce::dsp::AudioBlock<SampleType>& outputBlock) noexcept;
 
     //==============================================================================
-    SampleType threshold, thresholdInverse, currentRatio;
-    juce::dsp::BallisticsFilter<SampleType> envelopeFilter, RMSFilter;
-
-    double sampleRate = 44100.0;
-    SampleType thresholddB = -100, ratio = 10.0, attackTime = 1.0, releaseTime = 100.0,
-                            frequency = 2000.f, previousGain = 1;;
+    bool isOpen[2] = { false, false };
+    SampleType frequency = 2000.f, previousGain = 1;
     juce::Atomic<float> currentGain = 0.f;
     
     juce::dsp::IIR::Filter<SampleType> hissFilter[2];
+    SVFCascade<SampleType, 1> shelf, oversampledShelf;
+    
+    // 2x and 4x, both prepared so switching never allocates
+    std::unique_ptr<juce::dsp::Oversampling<SampleType>> oversamplers[2];
+    int oversamplingIndex = 0;
+    std::vector<SampleType> detectorGains[2];
+    SampleType oversampledGain[2] = { 1, 1 };
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HissGate)
 };
@@ -0,0 +1,213 @@
+/*
+  ==============================================================================
+
+    IdleDetector.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Per-channel detector that lets the processor skip its chain while the
+    guitar is idle. Once the input has stayed below the threshold for the
+    hold time and the chain output has settled below silenceLevel, the
+    output fades to silence and the chain is skipped, only the detectors of
+    its stages keep following the input. So the idle output differs from the
+    chain's by a residue below silenceLevel, whatever the frequency response
+    the chain settled at.
+
+    The first sample above the threshold runs the chain again from that
+    sample on, in the same block. The filters of the stages start from
+    silence there, which is what the output was.
+
+    Fading out starts at the start of an interval of spec.maximumBlockSize
+    samples and takes whole intervals, waking happens on the sample, and the
+    caller splits its blocks on the interval grid. So the decisions and the
+    output don't depend on the host block size.
+
+    Only valid for a chain without latency.
+*/
+template <typename SampleType>
+class IdleDetector
+{
+public:
+    //==============================================================================
+    /** Sets the level in dB above which the chain is woken up. */
+    void setThreshold (SampleType newThresholddB)
+    {
+        threshold = juce::Decibels::decibelsToGain (newThresholddB, static_cast<SampleType> (-200.0));
+    }
+
+    /** Sets how long in milliseconds the input must stay below the threshold
+        before the chain is skipped. Should cover the longest release in the chain.
+    */
+    void setHoldTime (SampleType newHoldTimeMs)
+    {
+        holdTime = newHoldTimeMs;
+        holdSamples = (juce::int64) (sampleRate * holdTime / 1000.0);
+        measureStart = holdSamples - (juce::int64) (sampleRate * measureTime / 1000.0);
+    }
+
+    /** When disabled the chain runs again from the next block on. */
+    void setEnabled (bool shouldBeEnabled)
+    {
+        enabled = shouldBeEnabled;
+
+        if (! enabled)
+            leaveIdle();
+    }
+
+    /** Runs the chain from the next block on and restarts the hold time, e.g. after
+        the chain settings changed.
+    */
+    void wake()
+    {
+        samplesBelowThreshold = 0;
+        leaveIdle();
+    }
+
+    bool isIdle() const
+    {
+        return idle;
+    }
+
+    //==============================================================================
+    /** Initialises the detector, maximumBlockSize is the decision interval. */
+    void prepare (const juce::dsp::ProcessSpec& spec)
+    {
+        jassert (spec.sampleRate > 0);
+
+        sampleRate = spec.sampleRate;
+        intervalLength = juce::jmax ((size_t) spec.maximumBlockSize, (size_t) 1);
+
+        setHoldTime (holdTime);
+        reset();
+    }
+
+    /** Resets the detector, the chain runs until the hold time passes again. */
+    void reset()
+    {
+        idle = measuring = false;
+        position = fadePosition = skipLength = 0;
+        samplesBelowThreshold = measuredSamples = 0;
+        outputEnergy = 0;
+    }
+
+    //==============================================================================
+    /** Returns how many samples at the start of the input block the chain skips, it
+        processes the rest. A block must not cross the end of an interval.
+    */
+    size_t pushInput (const SampleType* samples, size_t numSamples) noexcept
+    {
+        jassert (position + numSamples <= intervalLength);
+
+        if (position == 0)
+            decide();
+
+        position = (position + numSamples) % intervalLength;
+
+        auto first = (size_t) 0, last = numSamples;
+
+        while (first < numSamples && std::abs (samples[first]) <= threshold)
+            ++first;
+
+        while (last > first && std::abs (samples[last - 1]) <= threshold)
+            --last;
+
+        // Counted from the last sample above the threshold, whatever the block size
+        samplesBelowThreshold = first < numSamples ? (juce::int64) (numSamples - last)
+                                                   : samplesBelowThreshold + (juce::int64) numSamples;
+
+        skipLength = isSkipping() ? first : 0;
+
+        if (idle && first < numSamples)
+            leaveIdle();
+
+        return skipLength;
+    }
+
+    /** Silences the skipped samples of the last pushInput() block, fades the chain
+        output out while going idle or measures it.
+    */
+    void processOutput (SampleType* samples, size_t numSamples) noexcept
+    {
+        jassert (skipLength <= numSamples);
+
+        juce::FloatVectorOperations::clear (samples, (int) skipLength);
+        samples += skipLength;
+        numSamples -= skipLength;
+
+        if (idle)
+        {
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                fadePosition = juce::jmin (fadePosition + 1, fadeLength);
+                samples[i] *= static_cast<SampleType> (fadeLength - fadePosition) / static_cast<SampleType> (fadeLength);
+            }
+
+            return;
+        }
+
+        if (measuring)
+        {
+            for (size_t i = 0; i < numSamples; ++i)
+                outputEnergy += samples[i] * samples[i];
+
+            measuredSamples += (juce::int64) numSamples;
+        }
+    }
+
+private:
+    //==============================================================================
+    bool isSkipping() const noexcept
+    {
+        return idle && fadePosition == fadeLength;
+    }
+
+    void leaveIdle() noexcept
+    {
+        idle = false;
+        fadePosition = 0;
+    }
+
+    /** Goes idle at the start of an interval, from what came before it. */
+    void decide() noexcept
+    {
+        if (! idle && enabled && samplesBelowThreshold >= holdSamples && measuredSamples > 0)
+        {
+            auto silence = juce::Decibels::decibelsToGain (static_cast<SampleType> (silenceLevel));
+
+            if (outputEnergy <= silence * silence * static_cast<SampleType> (measuredSamples))
+            {
+                idle = true;
+                fadePosition = 0;
+            }
+        }
+
+        // Only the end of the hold time is measured, the chain is still releasing before that
+        measuring = ! idle && samplesBelowThreshold > measureStart;
+
+        if (! measuring)
+        {
+            outputEnergy = 0;
+            measuredSamples = 0;
+        }
+    }
+
+    //==============================================================================
+    size_t intervalLength = 1, position = 0, fadePosition = 0, skipLength = 0;
+
+    double sampleRate = 44100.0;
+    SampleType threshold = 0, holdTime = 500, outputEnergy = 0;
+    juce::int64 holdSamples = 0, measureStart = 0, samplesBelowThreshold = 0, measuredSamples = 0;
+    bool enabled = false, idle = false, measuring = false;
+
+    // A whole number of intervals of the processor's 32 sample grid
+    static constexpr size_t fadeLength = 64;
+    static constexpr double measureTime = 100.0;
+    static constexpr double silenceLevel = -90.0;
+};
@@ -11,111 +11,399 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include "RMSMeters.h"
+#include "Gate.h"
 
-// TODO: Make a parent Gate class
 //==============================================================================
 /*
-    Expanding noise gate. It's a modified juce::NoiseGate so it can report the attenuation depth
+    Expanding noise gate, started from juce::NoiseGate. Every mode runs one detector that
+    drives both the gain and the meters, and the gain is available from getGain()
 */
 template <typename SampleType>
-class NoiseReduction  :  public RMSMeters<float>
+class NoiseReduction final  :  public Gate<SampleType>
 {
 public:
+    static constexpr int numBands = 3;
+    
     //==============================================================================
-    /** Constructor. */
-    NoiseReduction()
+    /** Constructor, the noise gate closes down to silence. */
+    NoiseReduction() : Gate<SampleType> (static_cast<SampleType> (SquareLawDetector<SampleType>::silenceDecibels))
     {
-        RMSFilter.setLevelCalculationType (juce::dsp::BallisticsFilterLevelCalculationType::RMS);
-        RMSFilter.setAttackTime  (static_cast<SampleType> (0.0));
-        RMSFilter.setReleaseTime (static_cast<SampleType> (50.0));
+        update();
     }
 
     //==============================================================================
-    /** Sets the threshold in dB of the noise-gate.*/
-    void setThreshold (SampleType newThreshold) {noiseGate.setThreshold(newThreshold);}
-
-    /** Sets the ratio of the noise-gate (must be higher or equal to 1).*/
-    void setRatio (SampleType newRatio) {noiseGate.setRatio(newRatio);}
-
-    /** Sets the attack time in milliseconds of the noise-gate.*/
-    void setAttack (SampleType newAttack) {noiseGate.setAttack(newAttack);}
-
-    /** Sets the release time in milliseconds of the noise-gate.*/
-    void setRelease (SampleType newRelease) {noiseGate.setRelease(newRelease);}
+    /** Splits the signal into three Linkwitz-Riley bands, each with its own
+        detector, instead of gating the full band.
+    */
+    void setMultiband (bool shouldUseMultiband)
+    {
+        if (multiband == shouldUseMultiband)
+            return;
+        
+        multiband = shouldUseMultiband;
+        resetBands();
+    }
+    
+    /** Returns the gain applied at the end of the last processed block, in multiband
+        mode the energy weighted gain of the bands.
+    */
+    SampleType getGain (int channel) const noexcept                     { return currentGain[channel]; }
+    
+    /** Returns the mean-square envelope of a band in multiband mode. */
+    SampleType getBandEnvelope (int channel, int band) const noexcept   { return bandDetectors[band].getMeanSquare (channel); }
+    
+    /** setExternalEnvelope() for the band detectors of the multiband mode, all bands of a
+        channel must be set.
+    */
+    void setExternalBandEnvelope (int channel, int band, SampleType newEnvelope, size_t rampLength) noexcept
+    {
+        externalBandEnvelope[channel][band].start (getBandEnvelope (channel, band), newEnvelope, rampLength);
+        hasExternalBandEnvelopes = true;
+    }
+    
+    /** Goes back to the stage's own detectors. */
+    void clearExternalEnvelope() noexcept override
+    {
+        Gate<SampleType>::clearExternalEnvelope();
+        hasExternalBandEnvelopes = false;
+    }
 
     //==============================================================================
     /** Initialises the processor. */
-    void prepare (const juce::dsp::ProcessSpec& spec)
+    void prepare (const juce::dsp::ProcessSpec& spec) override
     {
-        jassert (spec.sampleRate > 0);
-        jassert (spec.numChannels > 0);
-
-        sampleRate = spec.sampleRate;
-
-        RMSFilter.prepare (spec);
-        noiseGate.prepare (spec);
-
+        Gate<SampleType>::prepare (spec);
+        
+        lowCrossover.setType (juce::dsp::LinkwitzRileyFilterType::lowpass);
+        lowCrossover.setCutoffFrequency (lowCrossoverFrequency);
+        highCrossover.setType (juce::dsp::LinkwitzRileyFilterType::lowpass);
+        highCrossover.setCutoffFrequency (highCrossoverFrequency);
+        lowBandAllpass.setType (juce::dsp::LinkwitzRileyFilterType::allpass);
+        lowBandAllpass.setCutoffFrequency (highCrossoverFrequency);
+        
+        lowCrossover.prepare (spec);
+        highCrossover.prepare (spec);
+        lowBandAllpass.prepare (spec);
+        
+        keyCrossover.setType (juce::dsp::LinkwitzRileyFilterType::lowpass);
+        keyCrossover.setCutoffFrequency (lowCrossoverFrequency);
+        keyHighCrossover.setType (juce::dsp::LinkwitzRileyFilterType::lowpass);
+        keyHighCrossover.setCutoffFrequency (highCrossoverFrequency);
+        
+        keyCrossover.prepare (spec);
+        keyHighCrossover.prepare (spec);
+        
+        for (auto& buffer : bandBuffers)
+            buffer.resize (juce::jmax (spec.maximumBlockSize, (juce::uint32) 1));
+        
+        for (auto& buffer : keyBandBuffers)
+            buffer.resize (juce::jmax (spec.maximumBlockSize, (juce::uint32) 1));
+        
+        bandGains.resize (juce::jmax (spec.maximumBlockSize, (juce::uint32) 1));
+        
+        for (auto& bandDetector : bandDetectors)
+            bandDetector.prepare (sampleRate);
+        
+        update();
         reset();
     }
 
     /** Resets the internal state variables of the processor. */
-    void reset()
+    void reset() override
     {
-        RMSFilter.reset();
-        noiseGate.reset();
+        Gate<SampleType>::reset();
+        currentGain[0] = currentGain[1] = 1;
+        resetBands();
     }
 
     //==============================================================================
-    /** Processes the input and output samples supplied in the processing context. */
-    template <typename ProcessContext>
-    void process (const ProcessContext& context) noexcept
+    /** Performs the processing operation on a single sample at a time. */
+    SampleType processSample (int channel, SampleType sample)
     {
-        const auto& inputBlock = context.getInputBlock();
-        auto& outputBlock      = context.getOutputBlock();
-        const auto numChannels = outputBlock.getNumChannels();
-        const auto numSamples  = outputBlock.getNumSamples();
-
-        jassert (inputBlock.getNumChannels() == numChannels);
-        jassert (inputBlock.getNumSamples() == numSamples);
+        return processSample (channel, sample, sample);
+    }
+    
+    /** Processes a single sample with the detectors keyed from key. Same gain law
+        as juce::NoiseGate, whose RMS filter doubles as the input meter.
+    */
+    SampleType processSample (int channel, SampleType sample, SampleType key)
+    {
+        auto gain = this->processGain (channel, key);
+        
+        if (channel < 2)
+            currentGain[channel] = gain;
+        
+        if (!channel)
+            this->setGainReduction(juce::Decibels::gainToDecibels(gain));
+        
+        return gain * sample;
+    }
+    
+    void snapToZero() noexcept override
+    {
+        Gate<SampleType>::snapToZero();
+        lowCrossover.snapToZero();
+        highCrossover.snapToZero();
+        lowBandAllpass.snapToZero();
+        keyCrossover.snapToZero();
+        keyHighCrossover.snapToZero();
+        
+        for (auto& bandDetector : bandDetectors)
+            bandDetector.snapToZero();
+    }
 
-        if (context.isBypassed)
+private:
+    //==============================================================================
+    using Gate<SampleType>::detector;
+    using Gate<SampleType>::envelope;
+    using Gate<SampleType>::hasExternalEnvelope;
+    using Gate<SampleType>::referenceEngine;
+    using Gate<SampleType>::sampleRate;
+    using Gate<SampleType>::controlInterval;
+    
+    static constexpr SampleType lowCrossoverFrequency = 250, highCrossoverFrequency = 2500;
+    
+    //==============================================================================
+    void update() override
+    {
+        Gate<SampleType>::update();
+        
+        for (auto& bandDetector : bandDetectors)
         {
-            outputBlock.copyFrom (inputBlock);
-            return;
+            bandDetector.setTimes (this->attackTime, this->releaseTime);
+            bandDetector.setThreshold (this->thresholddB, this->ratio, this->minGaindB);
         }
-
+    }
+    
+    //==============================================================================
+    void processGate (const juce::dsp::AudioBlock<const SampleType>& inputBlock,
+                      juce::dsp::AudioBlock<SampleType>& outputBlock) noexcept override
+    {
+        const auto numChannels = outputBlock.getNumChannels();
+        const auto numSamples  = outputBlock.getNumSamples();
+        
         for (size_t channel = 0; channel < numChannels; ++channel)
         {
             auto* inputSamples  = inputBlock .getChannelPointer (channel);
             auto* outputSamples = outputBlock.getChannelPointer (channel);
+            auto* keySamples    = this->getKeySamples (channel, inputSamples, numSamples);
+            
+            if (multiband && channel < 2)
+            {
+                processMultiband ((int) channel, inputSamples, keySamples, outputSamples, numSamples);
+                continue;
+            }
+            
+            if (! referenceEngine && channel < 2)
+            {
+                processFullBand ((int) channel, inputSamples, keySamples, outputSamples, numSamples);
+                continue;
+            }
 
             for (size_t i = 0; i < numSamples; ++i)
-                outputSamples[i] = processSample ((int) channel, inputSamples[i]);
+                outputSamples[i] = processSample ((int) channel, inputSamples[i], keySamples[i]);
         }
     }
-
-    /** Performs the processing operation on a single sample at a time. */
-    SampleType processSample (int channel, SampleType sample)
+    
+    /** Clears the crossovers, the band envelopes are kept as the best guess there is. */
+    void resetFilters() override
+    {
+        lowCrossover.reset();
+        highCrossover.reset();
+        lowBandAllpass.reset();
+        keyCrossover.reset();
+        keyHighCrossover.reset();
+    }
+    
+    /** The band detectors follow the key through the key crossovers, the phase of its
+        bands doesn't matter for detection.
+    */
+    void trackEnvelopes (const juce::dsp::AudioBlock<const SampleType>& inputBlock, size_t numSamples) noexcept override
+    {
+        if (! multiband)
+        {
+            Gate<SampleType>::trackEnvelopes (inputBlock, numSamples);
+            return;
+        }
+        
+        for (size_t channel = 0; channel < inputBlock.getNumChannels() && channel < 2; ++channel)
+        {
+            if (hasExternalBandEnvelopes)
+            {
+                for (int band = 0; band < numBands; ++band)
+                {
+                    auto& bandDetector = bandDetectors[band];
+                    auto target = externalBandEnvelope[channel][band].advance (bandDetector.getMeanSquare ((int) channel), numSamples);
+                    bandDetector.setMeanSquare ((int) channel, target);
+                }
+                
+                continue;
+            }
+            
+            auto* keySamples = this->getKeySamples (channel, inputBlock.getChannelPointer (channel), numSamples);
+            const auto maxChunkSize = keyBandBuffers[0].size();
+            
+            for (size_t offset = 0; offset < numSamples; offset += maxChunkSize)
+            {
+                auto chunkSize = juce::jmin (maxChunkSize, numSamples - offset);
+                auto* key = keySamples + offset;
+                auto* keyLow = keyBandBuffers[0].data();
+                auto* keyMid = keyBandBuffers[1].data();
+                auto* keyHigh = keyBandBuffers[2].data();
+                
+                for (size_t i = 0; i < chunkSize; ++i)
+                    keyCrossover.processSample ((int) channel, key[i], keyLow[i], keyHigh[i]);
+                
+                for (size_t i = 0; i < chunkSize; ++i)
+                    keyHighCrossover.processSample ((int) channel, keyHigh[i], keyMid[i], keyHigh[i]);
+                
+                for (int band = 0; band < numBands; ++band)
+                    bandDetectors[band].track ((int) channel, keyBandBuffers[band].data(), chunkSize);
+            }
+        }
+    }
+    
+    //==============================================================================
+    /** Fast engine: square law detector, or the external envelope, per control interval. */
+    void processFullBand (int channel, const SampleType* inputSamples, const SampleType* keySamples,
+                          SampleType* outputSamples, size_t numSamples) noexcept
     {
-        auto env = RMSFilter.processSample (channel, sample);
+        SampleType gains[controlInterval];
+        
+        for (size_t start = 0, length = 0; start < numSamples; start += length)
+        {
+            length = juce::jmin (detector.getSamplesToNextInterval (channel), numSamples - start);
+            auto isUnity = detector.isUnityGain (channel);
+            this->processDetector (channel, keySamples + start, gains, length);
+            
+            if (isUnity)
+            {
+                if (outputSamples != inputSamples)
+                    std::copy (inputSamples + start, inputSamples + start + length, outputSamples + start);
+                
+                continue;
+            }
+            
+            for (size_t i = 0; i < length; ++i)
+                outputSamples[start + i] = gains[i] * inputSamples[start + i];
+        }
+        
+        currentGain[channel] = detector.getGain (channel);
         
         if (!channel)
-            this->setInputRMS(float(env));
+            this->setGainReduction(juce::Decibels::gainToDecibels(float(currentGain[channel])));
+    }
+    
+    void processMultiband (int channel, const SampleType* inputSamples, const SampleType* keySamples,
+                           SampleType* outputSamples, size_t numSamples) noexcept
+    {
+        // An external envelope replaces the key split and the band detectors
+        const auto isExternal = hasExternalBandEnvelopes;
+        const auto isKeyed = keySamples != inputSamples && ! isExternal;
+        const auto maxChunkSize = bandBuffers[0].size();
         
-        SampleType modifiedSample = noiseGate.processSample(channel, sample);
+        for (size_t offset = 0; offset < numSamples; offset += maxChunkSize)
+        {
+            auto chunkSize = juce::jmin (maxChunkSize, numSamples - offset);
+            auto* input = inputSamples + offset;
+            auto* key = keySamples + offset;
+            auto* output = outputSamples + offset;
+            auto* low = bandBuffers[0].data();
+            auto* mid = bandBuffers[1].data();
+            auto* high = bandBuffers[2].data();
+            
+            // Crossovers run as separate passes so each filter keeps its state in registers
+            for (size_t i = 0; i < chunkSize; ++i)
+                lowCrossover.processSample (channel, input[i], low[i], high[i]);
+            
+            for (size_t i = 0; i < chunkSize; ++i)
+                highCrossover.processSample (channel, high[i], mid[i], high[i]);
+            
+            for (size_t i = 0; i < chunkSize; ++i)
+                low[i] = lowBandAllpass.processSample (channel, low[i]);
+            
+            // A key gets its own split, the phase of its bands doesn't matter for detection
+            if (isKeyed)
+            {
+                auto* keyLow = keyBandBuffers[0].data();
+                auto* keyMid = keyBandBuffers[1].data();
+                auto* keyHigh = keyBandBuffers[2].data();
+                
+                for (size_t i = 0; i < chunkSize; ++i)
+                    keyCrossover.processSample (channel, key[i], keyLow[i], keyHigh[i]);
+                
+                for (size_t i = 0; i < chunkSize; ++i)
+                    keyHighCrossover.processSample (channel, keyHigh[i], keyMid[i], keyHigh[i]);
+            }
+            
+            // The full band detector once per band
+            auto* gains = bandGains.data();
+            
+            for (int band = 0; band < numBands; ++band)
+            {
+                auto* samples = bandBuffers[band].data();
+                auto& bandDetector = bandDetectors[band];
+                
+                if (isExternal)
+                {
+                    for (size_t start = 0, length = 0; start < chunkSize; start += length)
+                    {
+                        length = juce::jmin (bandDetector.getSamplesToNextInterval (channel), chunkSize - start);
+                        auto target = externalBandEnvelope[channel][band].advance (bandDetector.getMeanSquare (channel), length);
+                        bandDetector.processExternal (channel, target, gains + start, length);
+                    }
+                }
+                else
+                {
+                    bandDetector.process (channel, isKeyed ? keyBandBuffers[band].data() : samples, gains, chunkSize);
+                }
+                
+                for (size_t i = 0; i < chunkSize; ++i)
+                    samples[i] *= gains[i];
+            }
+            
+            for (size_t i = 0; i < chunkSize; ++i)
+                output[i] = low[i] + mid[i] + high[i];
+        }
+        
+        // Energy weighted gain of all bands, the band detectors double as the meter
+        SampleType energy = 0, gatedEnergy = 0;
+        
+        for (int band = 0; band < numBands; ++band)
+        {
+            auto bandEnergy = bandDetectors[band].getMeanSquare (channel);
+            auto bandGain = bandDetectors[band].getGain (channel);
+            
+            energy += bandEnergy;
+            gatedEnergy += bandEnergy * bandGain * bandGain;
+        }
+        
+        currentGain[channel] = energy > static_cast<SampleType> (0.0) ? std::sqrt (gatedEnergy / energy) : static_cast<SampleType> (1.0);
         
         if (!channel)
-            this->setGainReduction(juce::Decibels::gainToDecibels(modifiedSample / sample));
+        {
+            this->setInputRMS(float(std::sqrt (energy)));
+            this->setGainReduction(juce::Decibels::gainToDecibels(float(currentGain[channel])));
+        }
+    }
+    
+    void resetBands()
+    {
+        resetFilters();
         
-        return modifiedSample;
+        for (auto& bandDetector : bandDetectors)
+            bandDetector.reset();
     }
-
-private:
+    
     //==============================================================================
-    SampleType threshold, thresholdInverse, currentRatio;
-    juce::dsp::BallisticsFilter<SampleType> RMSFilter;
-
-    double sampleRate = 44100.0;
-    juce::dsp::NoiseGate<SampleType> noiseGate;
+    bool multiband = false;
+    
+    juce::dsp::LinkwitzRileyFilter<SampleType> lowCrossover, highCrossover, lowBandAllpass,
+                                               keyCrossover, keyHighCrossover;
+    SquareLawDetector<SampleType> bandDetectors[numBands];
+    std::vector<SampleType> bandBuffers[numBands], keyBandBuffers[numBands], bandGains;
+    
+    SampleType currentGain[2] = { 1, 1 };
+    typename Gate<SampleType>::EnvelopeRamp externalBandEnvelope[2][numBands];
+    bool hasExternalBandEnvelopes = false;
 };
@@ -0,0 +1,191 @@
+/*
+  ==============================================================================
+
+    SVFCascade.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SVFKernels.h"
+
+//==============================================================================
+/*
+    Serial chain of trapezoidal (TPT / Simper) state variable filters for the
+    dynamic filters of the fast engine. Frequency and Q are set once per
+    stage, the gain only weights a response in the output mix:
+
+        peak:        y = x + (gain - 1) * k * band
+        high shelf:  y = x + (gain - 1) * high
+
+    so the gain can move every sample for one multiply, with no redesign. At
+    gain 1 both are exactly the input. The peak cuts the centre frequency by
+    gain with a fixed pole Q, unlike the RBJ peaking filter whose bandwidth
+    changes with the gain. The shelf reaches gain above the cutoff.
+
+    Float cascades of several stages run their block peak filters through the
+    SIMD kernels of SVFKernels.
+*/
+template <typename SampleType, int numStages, int numChannels = 2>
+class SVFCascade
+{
+public:
+    SVFCascade() noexcept
+    {
+        setKernelVariant (SVFKernels::getBestVariant());
+    }
+
+    /** Picks the kernel of the block peak filters, by default the fastest the CPU runs.
+        A variant the CPU can't run falls back to the scalar one.
+    */
+    void setKernelVariant (SVFKernels::Variant variant) noexcept
+    {
+        if constexpr (usesKernels)
+        {
+            peakKernel = SVFKernels::getPeakFunction (variant);
+
+            if (peakKernel == nullptr)
+                peakKernel = SVFKernels::getPeakFunction (SVFKernels::Variant::scalar);
+        }
+        else
+        {
+            juce::ignoreUnused (variant);
+        }
+    }
+
+    //==============================================================================
+    /** Sets the frequency and Q of one stage. */
+    void setStage (int stage, double sampleRate, SampleType frequency, SampleType q) noexcept
+    {
+        jassert (juce::isPositiveAndBelow (stage, numStages));
+        jassert (frequency > 0 && frequency < sampleRate * 0.5 && q > 0);
+
+        auto g = static_cast<SampleType> (std::tan (juce::MathConstants<double>::pi * frequency / sampleRate));
+
+        k[stage]  = static_cast<SampleType> (1.0) / q;
+        a1[stage] = static_cast<SampleType> (1.0) / (static_cast<SampleType> (1.0) + g * (g + k[stage]));
+        a2[stage] = g * a1[stage];
+        a3[stage] = g * a2[stage];
+    }
+
+    /** Clears the filter states of all channels. */
+    void reset() noexcept
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            std::fill (std::begin (ic1eq[channel]), std::end (ic1eq[channel]), static_cast<SampleType> (0));
+            std::fill (std::begin (ic2eq[channel]), std::end (ic2eq[channel]), static_cast<SampleType> (0));
+        }
+    }
+
+    /** Clears the filter states of one channel. */
+    void reset (int channel) noexcept
+    {
+        std::fill (std::begin (ic1eq[channel]), std::end (ic1eq[channel]), static_cast<SampleType> (0));
+        std::fill (std::begin (ic2eq[channel]), std::end (ic2eq[channel]), static_cast<SampleType> (0));
+    }
+
+    /** Rounds decaying states to zero before they become denormals. */
+    void snapToZero() noexcept
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            for (int stage = 0; stage < numStages; ++stage)
+            {
+                juce::dsp::util::snapToZero (ic1eq[channel][stage]);
+                juce::dsp::util::snapToZero (ic2eq[channel][stage]);
+            }
+        }
+    }
+
+    //==============================================================================
+    /** Runs one sample through every stage as a peak filter with the given gain. */
+    SampleType processPeak (int channel, SampleType sample, SampleType gain) noexcept
+    {
+        for (int stage = 0; stage < numStages; ++stage)
+        {
+            SampleType band, low;
+            tick (channel, stage, sample, band, low);
+            sample += (gain - static_cast<SampleType> (1.0)) * k[stage] * band;
+        }
+
+        return sample;
+    }
+
+    /** Runs a block in place through every stage as peak filters, one stage over
+        the whole block at a time, with a gain per sample.
+    */
+    void processPeak (int channel, SampleType* samples, const SampleType* gains, size_t numSamples) noexcept
+    {
+        if constexpr (usesKernels)
+        {
+            peakKernel ({ k, a1, a2, a3, ic1eq[channel], ic2eq[channel], numStages }, samples, gains, numSamples);
+            return;
+        }
+
+        for (int stage = 0; stage < numStages; ++stage)
+        {
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                SampleType band, low;
+                tick (channel, stage, samples[i], band, low);
+                samples[i] += (gains[i] - static_cast<SampleType> (1.0)) * k[stage] * band;
+            }
+        }
+    }
+
+    /** Runs one sample through every stage as a high shelf with the given gain. */
+    SampleType processHighShelf (int channel, SampleType sample, SampleType gain) noexcept
+    {
+        for (int stage = 0; stage < numStages; ++stage)
+        {
+            SampleType band, low;
+            tick (channel, stage, sample, band, low);
+            sample += (gain - static_cast<SampleType> (1.0)) * (sample - k[stage] * band - low);
+        }
+
+        return sample;
+    }
+
+    /** Block version of processHighShelf(), with a gain per sample. */
+    void processHighShelf (int channel, SampleType* samples, const SampleType* gains, size_t numSamples) noexcept
+    {
+        for (int stage = 0; stage < numStages; ++stage)
+        {
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                SampleType band, low;
+                tick (channel, stage, samples[i], band, low);
+                samples[i] += (gains[i] - static_cast<SampleType> (1.0)) * (samples[i] - k[stage] * band - low);
+            }
+        }
+    }
+
+private:
+    //==============================================================================
+    void tick (int channel, int stage, SampleType input, SampleType& band, SampleType& low) noexcept
+    {
+        auto& state1 = ic1eq[channel][stage];
+        auto& state2 = ic2eq[channel][stage];
+
+        auto v3 = input - state2;
+        band = a1[stage] * state1 + a2[stage] * v3;
+        low  = state2 + a2[stage] * state1 + a3[stage] * v3;
+
+        state1 = static_cast<SampleType> (2.0) * band - state1;
+        state2 = static_cast<SampleType> (2.0) * low - state2;
+    }
+
+    //==============================================================================
+    static constexpr bool usesKernels = std::is_same_v<SampleType, float> && numStages > 1 && numStages <= SVFKernels::maxStages;
+
+    // The kernels read every SIMD lane, the stages they don't use stay at zero
+    static constexpr int numLanes = usesKernels ? SVFKernels::maxStages : numStages;
+
+    SampleType k[numLanes] {}, a1[numLanes] {}, a2[numLanes] {}, a3[numLanes] {};
+    SampleType ic1eq[numChannels][numLanes] {}, ic2eq[numChannels][numLanes] {};
+
+    SVFKernels::PeakFunction peakKernel = nullptr;
+};
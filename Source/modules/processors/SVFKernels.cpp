@@ -0,0 +1,202 @@
+/*
+  ==============================================================================
+
+    SVFKernels.cpp
+
+  ==============================================================================
+*/
+
+#include "SVFKernels.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+
+ // Only the AVX2 kernel is built for AVX2, the rest of the plugin keeps the baseline
+ #if JUCE_GCC || JUCE_CLANG
+  #define PURRIST_TARGET_AVX2 __attribute__ ((target ("avx2")))
+ #else
+  #define PURRIST_TARGET_AVX2
+ #endif
+#endif
+
+namespace SVFKernels
+{
+    /** Stage by stage over the whole block, the same loop as SVFCascade's. */
+    static void processPeakScalar (const PeakStages& stages, float* samples, const float* gains, size_t numSamples) noexcept
+    {
+        for (int stage = 0; stage < stages.numStages; ++stage)
+        {
+            const auto k = stages.k[stage], a1 = stages.a1[stage], a2 = stages.a2[stage], a3 = stages.a3[stage];
+            auto state1 = stages.ic1eq[stage], state2 = stages.ic2eq[stage];
+
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                auto v3 = samples[i] - state2;
+                auto band = a1 * state1 + a2 * v3;
+                auto low  = state2 + a2 * state1 + a3 * v3;
+
+                state1 = 2.0f * band - state1;
+                state2 = 2.0f * low - state2;
+                samples[i] += (gains[i] - 1.0f) * k * band;
+            }
+
+            stages.ic1eq[stage] = state1;
+            stages.ic2eq[stage] = state2;
+        }
+    }
+
+   #if JUCE_INTEL
+    /** Two registers of four lanes. */
+    static void processPeakSSE2 (const PeakStages& stages, float* samples, const float* gains, size_t numSamples) noexcept
+    {
+        const __m128 k[]  { _mm_loadu_ps (stages.k),  _mm_loadu_ps (stages.k + 4) };
+        const __m128 a1[] { _mm_loadu_ps (stages.a1), _mm_loadu_ps (stages.a1 + 4) };
+        const __m128 a2[] { _mm_loadu_ps (stages.a2), _mm_loadu_ps (stages.a2 + 4) };
+        const __m128 a3[] { _mm_loadu_ps (stages.a3), _mm_loadu_ps (stages.a3 + 4) };
+        const __m128 lanes[] { _mm_setr_ps (0, 1, 2, 3), _mm_setr_ps (4, 5, 6, 7) };
+
+        __m128 ic1eq[] { _mm_loadu_ps (stages.ic1eq), _mm_loadu_ps (stages.ic1eq + 4) };
+        __m128 ic2eq[] { _mm_loadu_ps (stages.ic2eq), _mm_loadu_ps (stages.ic2eq + 4) };
+        __m128 output[] { _mm_setzero_ps(), _mm_setzero_ps() };
+        __m128 gain[] { _mm_set1_ps (1.0f), _mm_set1_ps (1.0f) };
+
+        const auto one = _mm_set1_ps (1.0f), two = _mm_set1_ps (2.0f), zero = _mm_setzero_ps();
+        const auto length = _mm_set1_ps ((float) numSamples), numStages = _mm_set1_ps ((float) stages.numStages);
+        const auto last = (size_t) stages.numStages - 1;
+
+        alignas (16) float outputs[maxStages];
+
+        for (size_t step = 0; step < numSamples + last; ++step)
+        {
+            auto isNew = step < numSamples;
+
+            // Lane 0 takes the next sample, every other lane the output of the lane before
+            const __m128 input[]
+            {
+                _mm_move_ss (_mm_shuffle_ps (output[0], output[0], _MM_SHUFFLE (2, 1, 0, 0)), _mm_set_ss (isNew ? samples[step] : 0.0f)),
+                _mm_move_ss (_mm_shuffle_ps (output[1], output[1], _MM_SHUFFLE (2, 1, 0, 0)),
+                             _mm_shuffle_ps (output[0], output[0], _MM_SHUFFLE (3, 3, 3, 3)))
+            };
+
+            gain[1] = _mm_move_ss (_mm_shuffle_ps (gain[1], gain[1], _MM_SHUFFLE (2, 1, 0, 0)),
+                                   _mm_shuffle_ps (gain[0], gain[0], _MM_SHUFFLE (3, 3, 3, 3)));
+            gain[0] = _mm_move_ss (_mm_shuffle_ps (gain[0], gain[0], _MM_SHUFFLE (2, 1, 0, 0)), _mm_set_ss (isNew ? gains[step] : 1.0f));
+
+            for (int half = 0; half < 2; ++half)
+            {
+                auto v3 = _mm_sub_ps (input[half], ic2eq[half]);
+                auto band = _mm_add_ps (_mm_mul_ps (a1[half], ic1eq[half]), _mm_mul_ps (a2[half], v3));
+                auto low = _mm_add_ps (_mm_add_ps (ic2eq[half], _mm_mul_ps (a2[half], ic1eq[half])), _mm_mul_ps (a3[half], v3));
+
+                // Lanes before their first sample or past their last one keep their state
+                auto position = _mm_sub_ps (_mm_set1_ps ((float) step), lanes[half]);
+                auto isActive = _mm_and_ps (_mm_and_ps (_mm_cmpge_ps (position, zero), _mm_cmplt_ps (position, length)),
+                                            _mm_cmplt_ps (lanes[half], numStages));
+
+                auto state1 = _mm_sub_ps (_mm_mul_ps (two, band), ic1eq[half]);
+                auto state2 = _mm_sub_ps (_mm_mul_ps (two, low), ic2eq[half]);
+                ic1eq[half] = _mm_or_ps (_mm_and_ps (isActive, state1), _mm_andnot_ps (isActive, ic1eq[half]));
+                ic2eq[half] = _mm_or_ps (_mm_and_ps (isActive, state2), _mm_andnot_ps (isActive, ic2eq[half]));
+
+                output[half] = _mm_add_ps (input[half], _mm_mul_ps (_mm_mul_ps (_mm_sub_ps (gain[half], one), k[half]), band));
+            }
+
+            if (step >= last)
+            {
+                _mm_store_ps (outputs, output[0]);
+                _mm_store_ps (outputs + 4, output[1]);
+                samples[step - last] = outputs[last];
+            }
+        }
+
+        _mm_storeu_ps (stages.ic1eq, ic1eq[0]);
+        _mm_storeu_ps (stages.ic1eq + 4, ic1eq[1]);
+        _mm_storeu_ps (stages.ic2eq, ic2eq[0]);
+        _mm_storeu_ps (stages.ic2eq + 4, ic2eq[1]);
+    }
+
+    /** One register of eight lanes. */
+    PURRIST_TARGET_AVX2
+    static void processPeakAVX2 (const PeakStages& stages, float* samples, const float* gains, size_t numSamples) noexcept
+    {
+        const auto k = _mm256_loadu_ps (stages.k), a1 = _mm256_loadu_ps (stages.a1),
+                   a2 = _mm256_loadu_ps (stages.a2), a3 = _mm256_loadu_ps (stages.a3);
+        const auto lanes = _mm256_setr_ps (0, 1, 2, 3, 4, 5, 6, 7);
+
+        auto ic1eq = _mm256_loadu_ps (stages.ic1eq), ic2eq = _mm256_loadu_ps (stages.ic2eq);
+        auto output = _mm256_setzero_ps(), gain = _mm256_set1_ps (1.0f);
+
+        const auto one = _mm256_set1_ps (1.0f), two = _mm256_set1_ps (2.0f), zero = _mm256_setzero_ps();
+        const auto length = _mm256_set1_ps ((float) numSamples), numStages = _mm256_set1_ps ((float) stages.numStages);
+        const auto rotate = _mm256_setr_epi32 (7, 0, 1, 2, 3, 4, 5, 6);
+        const auto last = (size_t) stages.numStages - 1;
+        const auto lastLane = _mm256_set1_epi32 ((int) last);
+
+        for (size_t step = 0; step < numSamples + last; ++step)
+        {
+            auto isNew = step < numSamples;
+
+            // Lane 0 takes the next sample, every other lane the output of the lane before
+            auto input = _mm256_blend_ps (_mm256_permutevar8x32_ps (output, rotate), _mm256_set1_ps (isNew ? samples[step] : 0.0f), 1);
+            gain = _mm256_blend_ps (_mm256_permutevar8x32_ps (gain, rotate), _mm256_set1_ps (isNew ? gains[step] : 1.0f), 1);
+
+            auto v3 = _mm256_sub_ps (input, ic2eq);
+            auto band = _mm256_add_ps (_mm256_mul_ps (a1, ic1eq), _mm256_mul_ps (a2, v3));
+            auto low = _mm256_add_ps (_mm256_add_ps (ic2eq, _mm256_mul_ps (a2, ic1eq)), _mm256_mul_ps (a3, v3));
+
+            // Lanes before their first sample or past their last one keep their state
+            auto position = _mm256_sub_ps (_mm256_set1_ps ((float) step), lanes);
+            auto isActive = _mm256_and_ps (_mm256_and_ps (_mm256_cmp_ps (position, zero, _CMP_GE_OQ), _mm256_cmp_ps (position, length, _CMP_LT_OQ)),
+                                           _mm256_cmp_ps (lanes, numStages, _CMP_LT_OQ));
+
+            ic1eq = _mm256_blendv_ps (ic1eq, _mm256_sub_ps (_mm256_mul_ps (two, band), ic1eq), isActive);
+            ic2eq = _mm256_blendv_ps (ic2eq, _mm256_sub_ps (_mm256_mul_ps (two, low), ic2eq), isActive);
+
+            output = _mm256_add_ps (input, _mm256_mul_ps (_mm256_mul_ps (_mm256_sub_ps (gain, one), k), band));
+
+            if (step >= last)
+                samples[step - last] = _mm256_cvtss_f32 (_mm256_permutevar8x32_ps (output, lastLane));
+        }
+
+        _mm256_storeu_ps (stages.ic1eq, ic1eq);
+        _mm256_storeu_ps (stages.ic2eq, ic2eq);
+    }
+   #endif
+
+    //==============================================================================
+    PeakFunction getPeakFunction (Variant variant)
+    {
+        switch (variant)
+        {
+           #if JUCE_INTEL
+            case Variant::avx2:     return juce::SystemStats::hasAVX2() ? processPeakAVX2 : nullptr;
+            case Variant::sse2:     return juce::SystemStats::hasSSE2() ? processPeakSSE2 : nullptr;
+           #else
+            case Variant::avx2:
+            case Variant::sse2:     return nullptr;
+           #endif
+            case Variant::scalar:
+            default:                return processPeakScalar;
+        }
+    }
+
+    Variant getBestVariant()
+    {
+        for (auto variant : { Variant::avx2, Variant::sse2 })
+            if (getPeakFunction (variant) != nullptr)
+                return variant;
+
+        return Variant::scalar;
+    }
+
+    const char* getVariantName (Variant variant)
+    {
+        switch (variant)
+        {
+            case Variant::avx2:     return "AVX2";
+            case Variant::sse2:     return "SSE2";
+            case Variant::scalar:
+            default:                return "scalar";
+        }
+    }
+}
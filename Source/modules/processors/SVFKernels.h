@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    SVFKernels.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Block kernels of SVFCascade's peak filters in float. The SIMD variants run
+    the stages as a wavefront, one stage per lane: at every step each lane
+    ticks its stage on the sample the lane before finished one step earlier,
+    so n samples through s stages take n + s - 1 steps instead of n * s ticks.
+
+    All variants do the same operations in the same order as the scalar
+    cascade, without fused multiply-adds, so their output is identical. The
+    fastest one the CPU runs is picked at runtime.
+*/
+namespace SVFKernels
+{
+    static constexpr int maxStages = 8;
+
+    /** Coefficients and states of one channel, maxStages values each with the
+        unused stages left at zero.
+    */
+    struct PeakStages
+    {
+        const float* k;
+        const float* a1;
+        const float* a2;
+        const float* a3;
+        float* ic1eq;
+        float* ic2eq;
+        int numStages;
+    };
+
+    /** Runs a block in place through the stages as peak filters, with a gain per sample. */
+    using PeakFunction = void (*) (const PeakStages& stages, float* samples, const float* gains, size_t numSamples) noexcept;
+
+    enum class Variant
+    {
+        scalar,
+        sse2,
+        avx2
+    };
+
+    /** Returns the kernel of a variant, nullptr if it can't run on this CPU. */
+    PeakFunction getPeakFunction (Variant variant);
+
+    /** Returns the fastest variant this CPU runs. */
+    Variant getBestVariant();
+
+    /** Returns the display name of a variant. */
+    const char* getVariantName (Variant variant);
+}
@@ -0,0 +1,310 @@
+/*
+  ==============================================================================
+
+    SpectralGate.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "SpectralGate.h"
+
+template <typename SampleType>
+SpectralGate<SampleType>::SpectralGate()
+{
+    analysisWindow.resize (fftSize);
+    synthesisWindow.resize (fftSize);
+
+    // Periodic Hann, analysis and synthesis windows overlap-add to 1.5 at 75% overlap
+    for (int i = 0; i < fftSize; i++)
+    {
+        analysisWindow[i] = 0.5f - 0.5f * std::cos (juce::MathConstants<float>::twoPi * (float) i / (float) fftSize);
+        synthesisWindow[i] = analysisWindow[i] / 1.5f;
+    }
+
+    power.resize (numBins);
+    targetGains.resize (numBins);
+    gainChange.resize (numBins);
+    learntPower.resize (numBins);
+    scaledNoise.resize (numBins);
+    noiseProfile.resize (numBins);
+
+    setReduction (reductiondB);
+}
+
+template <typename SampleType>
+void SpectralGate<SampleType>::setReduction (SampleType newReductiondB)
+{
+    jassert (newReductiondB >= static_cast<SampleType> (0.0));
+
+    reductiondB = newReductiondB;
+    auto floorGain = juce::Decibels::decibelsToGain (-float (reductiondB));
+    floorGainSquared = floorGain * floorGain;
+}
+
+template <typename SampleType>
+void SpectralGate<SampleType>::setLearning (bool shouldLearn)
+{
+    learning.store (shouldLearn);
+}
+
+template <typename SampleType>
+bool SpectralGate<SampleType>::isLearning() const
+{
+    return learning.load();
+}
+
+template <typename SampleType>
+bool SpectralGate<SampleType>::hasNoiseProfile() const
+{
+    return profileValid.load();
+}
+
+template <typename SampleType>
+void SpectralGate<SampleType>::getNoiseProfile (float* dest)
+{
+    if (learntProfile.receive())
+        juce::FloatVectorOperations::copy (noiseProfile.data(), learntProfile.getReadBuffer(), numBins);
+
+    juce::FloatVectorOperations::copy (dest, noiseProfile.data(), numBins);
+}
+
+template <typename SampleType>
+void SpectralGate<SampleType>::setNoiseProfile (const float* source)
+{
+    // A profile learnt before this one is stale
+    learntProfile.receive();
+
+    juce::FloatVectorOperations::copy (noiseProfile.data(), source, numBins);
+    juce::FloatVectorOperations::copy (restoredProfile.getWriteBuffer(), source, numBins);
+    restoredProfile.publish();
+    profileValid.store (true);
+}
+
+template <typename SampleType>
+void SpectralGate<SampleType>::clearNoiseProfile()
+{
+    learntProfile.receive();
+    profileValid.store (false);
+}
+
+//==============================================================================
+template <typename SampleType>
+SpectralGate<SampleType>::SpectrumExchange::SpectrumExchange()
+{
+    for (auto& buffer : buffers)
+        buffer.resize (numBins);
+}
+
+template <typename SampleType>
+void SpectralGate<SampleType>::SpectrumExchange::publish()
+{
+    writeIndex = shared.exchange (writeIndex | newFlag) & indexMask;
+}
+
+template <typename SampleType>
+bool SpectralGate<SampleType>::SpectrumExchange::receive()
+{
+    if ((shared.load() & newFlag) == 0)
+        return false;
+
+    readIndex = shared.exchange (readIndex) & indexMask;
+    return true;
+}
+
+//==============================================================================
+template <typename SampleType>
+void SpectralGate<SampleType>::prepare (const juce::dsp::ProcessSpec& spec)
+{
+    jassert (spec.sampleRate > 0);
+    jassert (spec.numChannels > 0);
+
+    sampleRate = spec.sampleRate;
+
+    // Bin gain ballistics, evaluated once per hop
+    gainAttack  = (float) std::exp (-hopSize / (sampleRate * 0.005));
+    gainRelease = (float) std::exp (-hopSize / (sampleRate * 0.05));
+
+    channels.resize (spec.numChannels);
+
+    for (auto& state : channels)
+    {
+        state.inputFifo.resize (fftSize);
+        state.outputFifo.resize (hopSize);
+        state.outputAccumulator.resize (fftSize);
+        state.frame.resize (fftSize * 2);
+        state.gains.resize (numBins);
+    }
+
+    reset();
+}
+
+template <typename SampleType>
+void SpectralGate<SampleType>::reset()
+{
+    for (auto& state : channels)
+    {
+        juce::FloatVectorOperations::clear (state.inputFifo.data(), fftSize);
+        juce::FloatVectorOperations::clear (state.outputFifo.data(), hopSize);
+        juce::FloatVectorOperations::clear (state.outputAccumulator.data(), fftSize);
+        juce::FloatVectorOperations::fill (state.gains.data(), 1.f, numBins);
+        state.hopPosition = 0;
+    }
+
+    framesStale = false;
+}
+
+//==============================================================================
+template <typename SampleType>
+SampleType SpectralGate<SampleType>::processSample (int channel, SampleType sample)
+{
+    auto& state = channels[(size_t) channel];
+
+    state.inputFifo[(size_t) (fftSize - hopSize + state.hopPosition)] = float (sample);
+    auto output = state.outputFifo[(size_t) state.hopPosition];
+
+    if (++state.hopPosition == hopSize)
+    {
+        state.hopPosition = 0;
+        processFrame (channel);
+    }
+
+    return static_cast<SampleType> (output);
+}
+
+template <typename SampleType>
+void SpectralGate<SampleType>::processFrame (int channel)
+{
+    using FVO = juce::FloatVectorOperations;
+
+    auto& state = channels[(size_t) channel];
+    auto* frame = state.frame.data();
+    auto* gains = state.gains.data();
+
+    if (!channel)
+    {
+        updateGainCurve();
+
+        auto* newestHop = state.inputFifo.data() + fftSize - hopSize;
+        float sumOfSquares = 0.f;
+
+        for (int i = 0; i < hopSize; i++)
+            sumOfSquares += newestHop[i] * newestHop[i];
+
+        this->setInputRMS (std::sqrt (sumOfSquares / (float) hopSize));
+    }
+
+    FVO::multiply (frame, state.inputFifo.data(), analysisWindow.data(), fftSize);
+    FVO::clear (frame + fftSize, fftSize);
+    fft.performRealOnlyForwardTransform (frame, true);
+
+    auto* binPower = power.data();
+
+    for (int bin = 0; bin < numBins; bin++)
+        binPower[bin] = frame[2 * bin] * frame[2 * bin] + frame[2 * bin + 1] * frame[2 * bin + 1];
+
+    if (wasLearning)
+    {
+        FVO::add (learntPower.data(), binPower, numBins);
+        learntFrames++;
+        FVO::fill (gains, 1.f, numBins);
+    }
+    else if (profileValid.load())
+    {
+        // Wiener-like gain in the power domain: g² = 1 - a·N/P, limited by the floor.
+        // The division and the square root have no vector operation, their loops are
+        // left plain for the compiler to vectorise
+        auto* noise = scaledNoise.data();
+        auto* target = targetGains.data();
+        auto* change = gainChange.data();
+
+        FVO::add (binPower, 1.0e-20f, numBins);
+
+        for (int bin = 0; bin < numBins; bin++)
+            binPower[bin] = noise[bin] / binPower[bin];
+
+        FVO::copyWithMultiply (binPower, binPower, -1.f, numBins);
+        FVO::add (binPower, 1.f, numBins);
+        FVO::max (binPower, binPower, floorGainSquared, numBins);
+
+        for (int bin = 0; bin < numBins; bin++)
+            target[bin] = std::sqrt (binPower[bin]);
+
+        // Per-bin ballistics, g = t + c·(g - t) with the attack coefficient while the gain
+        // rises to its target and the slower release, which masks musical noise, while it falls
+        FVO::subtract (change, gains, target, numBins);
+        FVO::copy (gains, target, numBins);
+        FVO::min (binPower, change, 0.f, numBins);
+        FVO::addWithMultiply (gains, binPower, gainAttack, numBins);
+        FVO::max (binPower, change, 0.f, numBins);
+        FVO::addWithMultiply (gains, binPower, gainRelease, numBins);
+    }
+    else
+    {
+        FVO::fill (gains, 1.f, numBins);
+    }
+
+    if (!channel)
+    {
+        auto gainSum = std::accumulate (gains, gains + numBins, 0.f);
+        this->setGainReduction (juce::Decibels::gainToDecibels (gainSum / (float) numBins));
+    }
+
+    for (int bin = 0; bin < numBins; bin++)
+    {
+        frame[2 * bin]     *= gains[bin];
+        frame[2 * bin + 1] *= gains[bin];
+    }
+
+    // Mirror the negative frequencies so the inverse transform is purely real
+    for (int bin = numBins; bin < fftSize; bin++)
+    {
+        frame[2 * bin]     =  frame[2 * (fftSize - bin)];
+        frame[2 * bin + 1] = -frame[2 * (fftSize - bin) + 1];
+    }
+
+    fft.performRealOnlyInverseTransform (frame);
+
+    FVO::multiply (frame, synthesisWindow.data(), fftSize);
+    FVO::add (state.outputAccumulator.data(), frame, fftSize);
+
+    auto* accumulator = state.outputAccumulator.data();
+    FVO::copy (state.outputFifo.data(), accumulator, hopSize);
+    std::copy (accumulator + hopSize, accumulator + fftSize, accumulator);
+    FVO::clear (accumulator + fftSize - hopSize, hopSize);
+
+    auto* input = state.inputFifo.data();
+    std::copy (input + hopSize, input + fftSize, input);
+}
+
+template <typename SampleType>
+void SpectralGate<SampleType>::updateGainCurve()
+{
+    using FVO = juce::FloatVectorOperations;
+
+    if (restoredProfile.receive())
+        FVO::copyWithMultiply (scaledNoise.data(), restoredProfile.getReadBuffer(), overSubtraction, numBins);
+
+    auto shouldLearn = learning.load();
+
+    if (shouldLearn && !wasLearning)
+    {
+        FVO::clear (learntPower.data(), numBins);
+        learntFrames = 0;
+    }
+    else if (!shouldLearn && wasLearning && learntFrames > 0)
+    {
+        auto* profile = learntProfile.getWriteBuffer();
+
+        FVO::copyWithMultiply (profile, learntPower.data(), 1.f / (float) learntFrames, numBins);
+        FVO::copyWithMultiply (scaledNoise.data(), profile, overSubtraction, numBins);
+        learntProfile.publish();
+        profileValid.store (true);
+    }
+
+    wasLearning = shouldLearn;
+}
+
+//==============================================================================
+template class SpectralGate<float>;
+template class SpectralGate<double>;
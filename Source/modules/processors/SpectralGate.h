@@ -0,0 +1,187 @@
+/*
+  ==============================================================================
+
+    SpectralGate.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RMSMeters.h"
+
+//==============================================================================
+/*
+    STFT spectral subtraction stage. While learning, it averages the power
+    spectrum of the input into a noise profile; afterwards every bin is
+    attenuated by a Wiener-like gain derived from that profile.
+
+    All buffers are allocated in prepare(), the audio thread only runs one
+    FFT pair per hop. The stage delays the signal by getLatencyInSamples().
+*/
+template <typename SampleType>
+class SpectralGate  :  public RMSMeters<float>
+{
+public:
+    SpectralGate();
+
+    //==============================================================================
+    /** Sets the maximum attenuation in dB applied to a noise-only bin.*/
+    void setReduction (SampleType newReductiondB);
+
+    /** Starts (true) or finishes (false) capturing the noise profile.
+        Learning should happen while the guitar is silent.
+    */
+    void setLearning (bool shouldLearn);
+
+    bool isLearning() const;
+
+    /** Returns true once a noise profile has been learnt or restored. */
+    bool hasNoiseProfile() const;
+
+    //==============================================================================
+    /** Returns the number of bins in the noise profile. */
+    static constexpr int getNumBins() { return fftSize / 2 + 1; }
+
+    /** Copies the noise profile power spectrum (getNumBins() values) to dest.
+        Call it from one thread other than the audio thread, like setNoiseProfile().
+    */
+    void getNoiseProfile (float* dest);
+
+    /** Replaces the noise profile with getNumBins() power values. The new profile
+        is picked up by the audio thread at the start of the next hop.
+    */
+    void setNoiseProfile (const float* source);
+
+    /** Drops the noise profile, the stage passes the signal until a new one is learnt or set. */
+    void clearNoiseProfile();
+
+    /** Returns the processing delay in samples. */
+    static constexpr int getLatencyInSamples() { return fftSize; }
+
+    //==============================================================================
+    /** Initialises the processor. */
+    void prepare (const juce::dsp::ProcessSpec& spec);
+
+    /** Resets the internal state variables of the processor. */
+    void reset();
+
+    //==============================================================================
+    /** Processes the input and output samples supplied in the processing context. */
+    template <typename ProcessContext>
+    void process (const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock      = context.getOutputBlock();
+        const auto numChannels = outputBlock.getNumChannels();
+        const auto numSamples  = outputBlock.getNumSamples();
+
+        jassert (inputBlock.getNumChannels() == numChannels);
+        jassert (inputBlock.getNumSamples() == numSamples);
+
+        if (context.isBypassed)
+        {
+            // The frames keep running while a profile is being learnt, so Learn works on a
+            // bypassed stage. Otherwise they stop and hold stale audio until re-enabled
+            if (learning.load() || wasLearning)
+            {
+                for (size_t channel = 0; channel < numChannels && channel < channels.size(); ++channel)
+                {
+                    auto* inputSamples = inputBlock.getChannelPointer (channel);
+
+                    for (size_t i = 0; i < numSamples; ++i)
+                        processSample ((int) channel, inputSamples[i]);
+                }
+            }
+            else
+            {
+                framesStale = true;
+            }
+
+            outputBlock.copyFrom (inputBlock);
+            return;
+        }
+
+        if (framesStale)
+            reset();
+
+        for (size_t channel = 0; channel < numChannels && channel < channels.size(); ++channel)
+        {
+            auto* inputSamples  = inputBlock .getChannelPointer (channel);
+            auto* outputSamples = outputBlock.getChannelPointer (channel);
+
+            for (size_t i = 0; i < numSamples; ++i)
+                outputSamples[i] = processSample ((int) channel, inputSamples[i]);
+        }
+    }
+
+    /** Performs the processing operation on a single sample at a time. */
+    SampleType processSample (int channel, SampleType inputValue);
+
+private:
+    //==============================================================================
+    static constexpr int fftOrder = 9;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int hopSize = fftSize / 4;
+    static constexpr int numBins = fftSize / 2 + 1;
+
+    struct ChannelState
+    {
+        std::vector<float> inputFifo, outputFifo, outputAccumulator, frame, gains;
+        int hopPosition = 0;
+    };
+
+    /** Hands a spectrum from one thread to the other without locks. The writer
+        fills its own buffer and swaps it for the shared one, the reader swaps its
+        own buffer for the shared one when it holds a new spectrum. Neither ever
+        touches the buffer the other one works on.
+    */
+    struct SpectrumExchange
+    {
+        SpectrumExchange();
+
+        float* getWriteBuffer()                 { return buffers[writeIndex].data(); }
+        const float* getReadBuffer() const      { return buffers[readIndex].data(); }
+
+        /** Shares the write buffer, called by the writer once it's filled. */
+        void publish();
+
+        /** Takes the shared buffer if it's new, returns false otherwise. */
+        bool receive();
+
+        std::vector<float> buffers[3];
+        int writeIndex = 0, readIndex = 1;
+        std::atomic<int> shared { 2 };
+
+        static constexpr int newFlag = 4, indexMask = 3;
+    };
+
+    void processFrame (int channel);
+    void updateGainCurve();
+
+    //==============================================================================
+    juce::dsp::FFT fft { fftOrder };
+    std::vector<ChannelState> channels;
+
+    std::vector<float> analysisWindow, synthesisWindow, power, targetGains, gainChange,
+                       learntPower, scaledNoise;
+
+    int learntFrames = 0;
+    std::atomic<bool> learning { false }, profileValid { false };
+    bool wasLearning = false, framesStale = false;
+
+    // Restored profiles go to the audio thread, learnt ones come back. The message
+    // thread keeps the latest of both in noiseProfile
+    SpectrumExchange restoredProfile, learntProfile;
+    std::vector<float> noiseProfile;
+
+    double sampleRate = 44100.0;
+    SampleType reductiondB = 18;
+    float floorGainSquared = 0.f, gainAttack = 0.f, gainRelease = 0.f;
+
+    // Over-subtraction factor, trades residual noise for musical noise
+    static constexpr float overSubtraction = 2.f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectralGate)
+};
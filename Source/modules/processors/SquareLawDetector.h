@@ -0,0 +1,317 @@
+/*
+  ==============================================================================
+
+    SquareLawDetector.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Detector and downward expander gain law of the fast engine, working on
+    squares and logarithms end to end.
+
+    The first stage is the mean square of juce::dsp::BallisticsFilter in RMS
+    mode without its square root, the second stage runs the attack and
+    release ballistics on that mean square (with halved times, so the
+    amplitude follows the given ones). The gain law
+
+        gain = (meanSquare / threshold^2) ^ ((ratio - 1) / 2)
+
+    is evaluated as exp2 (exponent * (log2 (meanSquare) - log2 (threshold^2)))
+    with polynomial log2/exp2. Gains at or below silenceDecibels are 0, lower
+    ones would only scale a noise floor into denormals.
+
+    The detector runs decimated: per control interval the key is squared and
+    reduced to its mean and peak, both ballistics stages step once with their coefficients raised
+    to the interval length, the gain law is evaluated once and the gain ramps
+    linearly back to the audio rate. The envelopes carry nothing near the
+    control rate, so per sample only a multiply-add is left.
+
+    The intervals run on a fixed grid that carries over between calls, and the
+    gain ramps over an interval towards the value measured on the one before,
+    so the output doesn't depend on how the calls split the signal.
+*/
+template <typename SampleType>
+class SquareLawDetector
+{
+public:
+    static constexpr size_t controlInterval = 16;
+    static constexpr float silenceDecibels = -140.0f;
+
+    //==============================================================================
+    /** Sets the sample rate, call setTimes() again afterwards. */
+    void prepare (double newSampleRate) noexcept
+    {
+        jassert (newSampleRate > 0);
+
+        sampleRate = newSampleRate;
+        RMSReleaseCte = calculateCte (sampleRate, static_cast<SampleType> (50.0));
+        reset();
+    }
+
+    /** Sets the attack and release times in milliseconds of the envelope. */
+    void setTimes (SampleType attackMs, SampleType releaseMs) noexcept
+    {
+        attackCte  = calculateCte (sampleRate, attackMs * static_cast<SampleType> (0.5));
+        releaseCte = calculateCte (sampleRate, releaseMs * static_cast<SampleType> (0.5));
+    }
+
+    /** Sets the threshold in dB, the ratio and the lowest gain in dB of the expander. */
+    void setThreshold (SampleType thresholddB, SampleType ratio, SampleType minGaindB = static_cast<SampleType> (silenceDecibels)) noexcept
+    {
+        jassert (ratio >= static_cast<SampleType> (1.0));
+
+        thresholdSquaredLog2 = 2.0f * (float) thresholddB / decibelsPerOctave;
+        exponent = ((float) ratio - 1.0f) * 0.5f;
+        minGainLog2 = juce::jmax (silenceLog2, (float) minGaindB / decibelsPerOctave);
+    }
+
+    /** Clears the envelopes, opens the gate and starts a new interval. */
+    void reset() noexcept
+    {
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            inputMeanSquare[channel] = 0;
+            meanSquare[channel] = 0;
+            gain[channel] = target[channel] = 1;
+            gainStep[channel] = 0;
+            intervals[channel] = {};
+        }
+    }
+
+    /** Rounds decaying envelopes to zero before they become denormals. The envelopes are
+        mean squares, so the limit sits far below the one of juce::dsp::util::snapToZero.
+    */
+    void snapToZero() noexcept
+    {
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            if (inputMeanSquare[channel] < minimumMeanSquare)   inputMeanSquare[channel] = 0;
+            if (meanSquare[channel] < minimumMeanSquare)        meanSquare[channel] = 0;
+        }
+    }
+
+    //==============================================================================
+    /** Returns the number of samples left in the current interval. Blocks that end
+        there at the latest keep one gain ramp, see isUnityGain().
+    */
+    size_t getSamplesToNextInterval (int channel) const noexcept
+    {
+        return controlInterval - intervals[channel].position;
+    }
+
+    /** Returns true if every gain of the current interval is exactly 1. */
+    bool isUnityGain (int channel) const noexcept
+    {
+        return gain[channel] == static_cast<SampleType> (1.0) && gainStep[channel] == static_cast<SampleType> (0.0);
+    }
+
+    /** Runs the detector over a block of key samples and writes the gain of every sample. */
+    void process (int channel, const SampleType* key, SampleType* gains, size_t numSamples) noexcept
+    {
+        jassert (juce::isPositiveAndBelow (channel, 2));
+
+        for (size_t start = 0; start < numSamples;)
+        {
+            auto length = juce::jmin (getSamplesToNextInterval (channel), numSamples - start);
+            rampGain (channel, gains + start, length);
+
+            if (accumulate (channel, key + start, length))
+                stepEnvelopes (channel);
+
+            start += length;
+        }
+    }
+
+    /** Runs only the envelopes over a block of key samples, so that a bypassed stage
+        resumes with a settled detector. The gain jumps to the value of the last interval.
+    */
+    void track (int channel, const SampleType* key, size_t numSamples) noexcept
+    {
+        jassert (juce::isPositiveAndBelow (channel, 2));
+
+        for (size_t start = 0; start < numSamples;)
+        {
+            auto length = juce::jmin (getSamplesToNextInterval (channel), numSamples - start);
+
+            if (accumulate (channel, key + start, length))
+                stepEnvelopes (channel);
+
+            start += length;
+        }
+
+        gain[channel] = target[channel] = getGainForMeanSquare (meanSquare[channel]);
+        gainStep[channel] = 0;
+    }
+
+    /** Sets both envelopes and the gain from a mean square computed elsewhere. */
+    void setMeanSquare (int channel, SampleType newMeanSquare) noexcept
+    {
+        inputMeanSquare[channel] = newMeanSquare;
+        meanSquare[channel] = newMeanSquare;
+        gain[channel] = target[channel] = getGainForMeanSquare (newMeanSquare);
+        gainStep[channel] = 0;
+    }
+
+    /** Follows a mean square computed elsewhere instead of running the detector, and
+        writes the gain of every sample. The envelope takes the given value when the
+        block completes an interval, so blocks should end there at the latest.
+    */
+    void processExternal (int channel, SampleType targetMeanSquare, SampleType* gains, size_t numSamples) noexcept
+    {
+        jassert (juce::isPositiveAndBelow (channel, 2));
+
+        for (size_t start = 0; start < numSamples;)
+        {
+            auto length = juce::jmin (getSamplesToNextInterval (channel), numSamples - start);
+            rampGain (channel, gains + start, length);
+
+            auto& interval = intervals[channel];
+            interval.position += length;
+
+            if (interval.position == controlInterval)
+            {
+                interval = {};
+                inputMeanSquare[channel] = targetMeanSquare;
+                meanSquare[channel] = targetMeanSquare;
+                startGainRamp (channel);
+            }
+
+            start += length;
+        }
+    }
+
+    //==============================================================================
+    /** Returns the mean square of the input, before the attack and release. */
+    SampleType getInputMeanSquare (int channel) const noexcept  { return inputMeanSquare[channel]; }
+
+    /** Returns the mean square envelope the gain is computed from. */
+    SampleType getMeanSquare (int channel) const noexcept       { return meanSquare[channel]; }
+
+    /** Returns the gain of the last processed sample. */
+    SampleType getGain (int channel) const noexcept             { return gain[channel]; }
+
+    /** Evaluates the gain law for a mean square envelope value. */
+    SampleType getGainForMeanSquare (SampleType envelope) const noexcept
+    {
+        auto gainLog2 = juce::jlimit (minGainLog2, 0.0f, exponent * (fastLog2 ((float) envelope) - thresholdSquaredLog2));
+        return gainLog2 <= silenceLog2 ? static_cast<SampleType> (0) : static_cast<SampleType> (fastExp2 (gainLog2));
+    }
+
+    //==============================================================================
+    /** log2 of a positive number, within 3e-5. Zero and denormals give about -127. */
+    static float fastLog2 (float x) noexcept
+    {
+        juce::uint32 bits;
+        std::memcpy (&bits, &x, sizeof (bits));
+
+        auto exponentBits = (int) ((bits >> 23) & 0xff) - 127;
+        bits = (bits & 0x007fffff) | 0x3f800000;
+
+        float mantissa;
+        std::memcpy (&mantissa, &bits, sizeof (mantissa));
+
+        auto t = mantissa - 1.0f;
+        return (float) exponentBits
+             + t * (1.4418793f + t * (-0.70885857f + t * (0.41522276f + t * (-0.19348613f + t * 0.045254476f))));
+    }
+
+    /** 2^x for x in [-126, 0], within 5e-6 relative. */
+    static float fastExp2 (float x) noexcept
+    {
+        auto whole = std::floor (x);
+        auto t = x - whole;
+
+        auto bits = (juce::uint32) ((int) whole + 127) << 23;
+        float scale;
+        std::memcpy (&scale, &bits, sizeof (scale));
+
+        return scale * (1.0f + t * (0.69301737f + t * (0.24144966f + t * (0.051945949f + t * 0.013582852f))));
+    }
+
+private:
+    //==============================================================================
+    struct Interval
+    {
+        SampleType sum = 0, peak = 0;
+        size_t position = 0;
+    };
+
+    /** Adds the squares of a block inside the current interval, returns true once it's complete. */
+    bool accumulate (int channel, const SampleType* key, size_t length) noexcept
+    {
+        auto& interval = intervals[channel];
+
+        for (size_t i = 0; i < length; ++i)
+        {
+            auto square = key[i] * key[i];
+            interval.sum += square;
+            interval.peak = juce::jmax (interval.peak, square);
+        }
+
+        interval.position += length;
+        return interval.position == controlInterval;
+    }
+
+    void stepEnvelopes (int channel) noexcept
+    {
+        auto& interval = intervals[channel];
+        auto& input = inputMeanSquare[channel];
+        auto& envelope = meanSquare[channel];
+
+        // The RMS filter attacks instantly, so it jumps to the largest square and
+        // otherwise releases towards the mean over the whole interval
+        auto average = interval.sum / static_cast<SampleType> (controlInterval);
+        input = interval.peak > input ? interval.peak : average + RMSReleaseCte * (input - average);
+        envelope = input + (input > envelope ? attackCte : releaseCte) * (envelope - input);
+
+        interval = {};
+        startGainRamp (channel);
+    }
+
+    /** Lands on the target of the finished interval and ramps towards the new one. */
+    void startGainRamp (int channel) noexcept
+    {
+        gain[channel] = target[channel];
+        target[channel] = getGainForMeanSquare (meanSquare[channel]);
+        gainStep[channel] = (target[channel] - gain[channel]) / static_cast<SampleType> (controlInterval);
+    }
+
+    void rampGain (int channel, SampleType* gains, size_t length) noexcept
+    {
+        auto current = gain[channel];
+        auto step = gainStep[channel];
+
+        for (size_t i = 0; i < length; ++i)
+            gains[i] = current += step;
+
+        gain[channel] = current;
+    }
+
+    /** Coefficient of a whole interval with a constant input. */
+    static SampleType calculateCte (double rate, SampleType timeMs) noexcept
+    {
+        return timeMs < static_cast<SampleType> (1.0e-3) ? static_cast<SampleType> (0.0)
+            : static_cast<SampleType> (std::exp (-2.0 * juce::MathConstants<double>::pi * 1000.0 * (double) controlInterval / (rate * timeMs)));
+    }
+
+    //==============================================================================
+    static constexpr SampleType minimumMeanSquare = static_cast<SampleType> (1.0e-30);
+
+    // 20 log10 (x) = 6.0206 log2 (x)
+    static constexpr float decibelsPerOctave = 6.0205999f;
+    static constexpr float silenceLog2 = silenceDecibels / decibelsPerOctave;
+
+    double sampleRate = 44100.0;
+    SampleType RMSReleaseCte = 0, attackCte = 0, releaseCte = 0;
+    float thresholdSquaredLog2 = 0, exponent = 1, minGainLog2 = silenceLog2;
+
+    SampleType inputMeanSquare[2] = { 0, 0 }, meanSquare[2] = { 0, 0 };
+    SampleType gain[2] = { 1, 1 }, target[2] = { 1, 1 }, gainStep[2] = { 0, 0 };
+    Interval intervals[2];
+};
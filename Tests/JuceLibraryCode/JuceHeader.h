@@ -0,0 +1,20 @@
+/*
+  ==============================================================================
+
+    JuceHeader.h
+
+    Stands in for the header the Projucer generates for the plugin, so the
+    plugin sources build unchanged in the CMake test target.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <juce_audio_utils/juce_audio_utils.h>
+#include <juce_dsp/juce_dsp.h>
+#include <juce_gui_extra/juce_gui_extra.h>
+
+#include <BinaryData.h>
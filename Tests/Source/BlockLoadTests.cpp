@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+
+    BlockLoadTests.cpp
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+//==============================================================================
+/*
+    Time of every processBlock call of the processor, as a share of the block
+    length. Averages hide the blocks that miss the deadline, e.g. a gain
+    transition that redesigns the filters of the reference engine.
+*/
+namespace
+{
+    /** Renders the whole blocks of a signal on both channels and returns the load of each. */
+    std::vector<double> renderBlockLoads (PurristAudioProcessor& processor, const juce::AudioBuffer<float>& input, int blockSize)
+    {
+        TestHelpers::prepareProcessor (processor, blockSize);
+
+        juce::AudioBuffer<float> buffer (2, blockSize);
+        juce::MidiBuffer midi;
+        std::vector<double> loads;
+        loads.reserve ((size_t) (input.getNumSamples() / blockSize));
+
+        auto budgetTicks = (double) blockSize / TestSignals::sampleRate * (double) juce::Time::getHighResolutionTicksPerSecond();
+
+        for (int offset = 0; offset + blockSize <= input.getNumSamples(); offset += blockSize)
+        {
+            for (int channel = 0; channel < 2; channel++)
+                buffer.copyFrom (channel, 0, input, 0, offset, blockSize);
+
+            auto start = juce::Time::getHighResolutionTicks();
+            processor.processBlock (buffer, midi);
+            loads.push_back ((double) (juce::Time::getHighResolutionTicks() - start) / budgetTicks);
+        }
+
+        return loads;
+    }
+}
+
+//==============================================================================
+class BlockLoadTests  : public juce::UnitTest
+{
+public:
+    BlockLoadTests() : juce::UnitTest ("Block load", "Regression") {}
+
+    void runTest() override
+    {
+        beginTest ("Stage timers keep the block sizes apart");
+
+        PurristAudioProcessor processor;
+        processor.getStageTimers().setEnabled (true);
+
+        auto input = TestSignals::createNoiseBursts();
+        TestHelpers::renderProcessor (processor, input, { 32, 512, 100 });
+
+        // The same blocks as renderProcessor(), the last one is cut short
+        const std::vector<int> blockSizes { 32, 512, 100 };
+        juce::int64 numBlocks[StageTimers::numSizeBuckets] {};
+
+        for (int offset = 0, block = 0; offset < input.getNumSamples(); block++)
+        {
+            auto length = juce::jmin (blockSizes[(size_t) block % blockSizes.size()], input.getNumSamples() - offset);
+            numBlocks[getSizeBucket (length)]++;
+            offset += length;
+        }
+
+        auto snapshot = processor.getStageTimers().getSnapshot();
+
+        for (int bucket = 0; bucket < StageTimers::numSizeBuckets; bucket++)
+            expectEquals (snapshot.bucketLoads[bucket].numBlocks, numBlocks[bucket], "Blocks in bucket " + juce::String (bucket));
+
+        expectEquals (snapshot.bucketLoads[0].maxBlockSize, 32);
+        expectEquals (snapshot.bucketLoads[2].minBlockSize, 100);
+        expectEquals (snapshot.bucketLoads[4].maxBlockSize, 512);
+    }
+
+private:
+    static int getSizeBucket (int numSamples)
+    {
+        int bucket = 0;
+
+        while (bucket < StageTimers::numSizeBuckets - 1 && numSamples > (StageTimers::smallestBucketSize << bucket))
+            bucket++;
+
+        return bucket;
+    }
+};
+
+static BlockLoadTests blockLoadTests;
+
+//==============================================================================
+/*
+    Load percentiles of the processor per host block size over a long session
+    of all the test signals, with both engines. Every block over the deadline
+    fraction of --deadline is reported with its position in the session.
+*/
+class BlockLoadBenchmark  : public juce::UnitTest
+{
+public:
+    BlockLoadBenchmark() : juce::UnitTest ("Block load", "Benchmark") {}
+
+    void runTest() override
+    {
+        auto session = TestSignals::createSession (sessionSeconds);
+        auto deadline = TestOptions::get().deadlineFraction;
+
+        for (auto useReferenceEngine : { false, true })
+        {
+            for (auto blockSize : { 32, 64, 128, 256, 512, 1024 })
+            {
+                beginTest (juce::String (useReferenceEngine ? "Reference" : "Fast") + " engine, blocks of " + juce::String (blockSize));
+
+                PurristAudioProcessor processor;
+
+                if (useReferenceEngine)
+                    TestHelpers::setParameter (processor, "dsp_engine", 1.f);
+
+                auto loads = renderBlockLoads (processor, session, blockSize);
+                auto sorted = loads;
+                std::sort (sorted.begin(), sorted.end());
+
+                // Nearest rank
+                auto getPercentage = [&] (double share)
+                {
+                    auto rank = juce::jlimit ((size_t) 1, sorted.size(), (size_t) std::ceil (share * (double) sorted.size()));
+                    return juce::String (100.0 * sorted[rank - 1], 1) + " %";
+                };
+
+                logMessage ("load p50 " + getPercentage (0.5) + ", p99 " + getPercentage (0.99) + ", p99.9 " + getPercentage (0.999)
+                            + ", max " + getPercentage (1.0) + " over " + juce::String ((int) loads.size()) + " blocks");
+
+                int numLateBlocks = 0;
+
+                for (size_t block = 0; block < loads.size(); ++block)
+                {
+                    if (loads[block] <= deadline)
+                        continue;
+
+                    if (++numLateBlocks <= maxReportedBlocks)
+                        logMessage ("late block at " + juce::String ((double) block * blockSize / TestSignals::sampleRate, 3) + " s, load "
+                                    + juce::String (100.0 * loads[block], 1) + " %");
+                }
+
+                expectEquals (numLateBlocks, 0, "Blocks over " + juce::String (100.0 * deadline, 0) + " % of their length");
+            }
+        }
+    }
+
+private:
+    static constexpr double sessionSeconds = 60.0;
+    static constexpr int maxReportedBlocks = 10;
+};
+
+static BlockLoadBenchmark blockLoadBenchmark;
@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    BypassTests.cpp
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+//==============================================================================
+/*
+    A stage with latency fades between its delayed output and a dry signal
+    delayed by as much, and stays delayed while bypassed. With the gate open
+    the output is the input delayed by the latency all the way through, any
+    comb filtering of the fades shows up as a large error.
+*/
+class BypassTests  : public juce::UnitTest
+{
+public:
+    BypassTests() : juce::UnitTest ("Bypass", "Regression") {}
+
+    void runTest() override
+    {
+        beginTest ("Bypass fade / buzz_multirate");
+        {
+            BuzzGate<float> gate;
+            gate.setThreshold (-80.f);
+            gate.setRatio (2.f);
+            gate.setMultirate (true);
+            checkFades (gate);
+        }
+
+        beginTest ("Bypass fade / buzz");
+        {
+            BuzzGate<float> gate;
+            gate.setThreshold (-80.f);
+            gate.setRatio (2.f);
+            checkFades (gate);
+        }
+    }
+
+private:
+    static constexpr int blockSize = 32;
+
+    template <typename Stage>
+    void checkFades (Stage& gate)
+    {
+        gate.prepare ({ TestSignals::sampleRate, (juce::uint32) blockSize, 1 });
+
+        const auto latency = gate.getLatencyInSamples();
+        const auto numSamples = (int) (0.6 * TestSignals::sampleRate);
+        const auto bypassStart = (int) (0.2 * TestSignals::sampleRate), bypassEnd = (int) (0.4 * TestSignals::sampleRate);
+        const auto settleTime = (int) (0.05 * TestSignals::sampleRate);
+
+        // The filters of the signal path restart after a bypass, the fade back in hides that
+        const auto restartLength = (int) (BypassFader<float>::fadeTimeMs * 0.001 * TestSignals::sampleRate);
+
+        juce::AudioBuffer<float> input (1, numSamples);
+
+        for (int i = 0; i < numSamples; i++)
+            input.setSample (0, i, 0.5f * std::sin (juce::MathConstants<float>::twoPi * 220.f * (float) i / (float) TestSignals::sampleRate));
+
+        juce::AudioBuffer<float> output (input);
+        juce::dsp::AudioBlock<float> block (output);
+
+        for (int offset = 0; offset < numSamples; offset += blockSize)
+        {
+            auto subBlock = block.getSubBlock ((size_t) offset, (size_t) blockSize);
+            juce::dsp::ProcessContextReplacing<float> context (subBlock);
+            context.isBypassed = offset >= bypassStart && offset < bypassEnd;
+            gate.process (context);
+        }
+
+        double maxError = 0, maxRestartError = 0;
+
+        for (int i = settleTime; i < numSamples; i++)
+        {
+            auto error = (double) std::abs (output.getSample (0, i) - input.getSample (0, i - latency));
+            auto& limit = i >= bypassEnd && i < bypassEnd + restartLength ? maxRestartError : maxError;
+            limit = juce::jmax (limit, error);
+        }
+
+        expect (maxError < 1.0e-4, "Error against the delayed input " + juce::String (maxError, 6));
+        expect (maxRestartError < 0.05, "Error against the delayed input after the bypass " + juce::String (maxRestartError, 6));
+    }
+};
+
+static BypassTests bypassTests;
@@ -0,0 +1,172 @@
+/*
+  ==============================================================================
+
+    DenormalTests.cpp
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+//==============================================================================
+/*
+    Notes that die out into silence, run through the chain without
+    processBlock and with denormals enabled, like the offline CLI or a host
+    that resets MXCSR. The stages have to stay denormal-free on their own,
+    also when a closed gate scales a low noise floor instead of silence.
+*/
+namespace
+{
+    struct DecayResult
+    {
+        int numSubnormals = 0;
+        double noteNanosecondsPerSample = 0, tailNanosecondsPerSample = 0;
+    };
+
+    DecayResult renderDecayingNotes (bool useReferenceEngine, bool flushDenormals, float noiseLevel = 0.f)
+    {
+        constexpr int blockSize = 32;
+
+        // processBlock flushes denormals in hardware, the stages must not rely on it
+        std::unique_ptr<juce::ScopedNoDenormals> noDenormals;
+
+        if (flushDenormals)
+            noDenormals = std::make_unique<juce::ScopedNoDenormals>();
+
+        MonoChain chain;
+        chain.setBypassed<ChainPositions::spectralGate> (true);
+
+        auto& buzzGate = chain.get<ChainPositions::buzzGate>();
+        buzzGate.setThreshold (-42.f);
+        buzzGate.setRatio (2.f);
+        buzzGate.setAttack (50.f);
+        buzzGate.setRelease (150.f);
+        buzzGate.setReferenceEngine (useReferenceEngine);
+
+        auto& hissGate = chain.get<ChainPositions::hissGate>();
+        hissGate.setThreshold (-48.f);
+        hissGate.setRatio (2.f);
+        hissGate.setCutoff (2000.f);
+        hissGate.setAttack (50.f);
+        hissGate.setRelease (300.f);
+        hissGate.setReferenceEngine (useReferenceEngine);
+
+        auto& noiseGate = chain.get<ChainPositions::noiseGate>();
+        // Over a noise floor the expander cuts it to gains far below the smallest normal float
+        noiseGate.setThreshold (noiseLevel > 0.f ? -20.f : -54.f);
+        noiseGate.setRatio (noiseLevel > 0.f ? 8.f : 3.f);
+        noiseGate.setAttack (30.f);
+        noiseGate.setRelease (200.f);
+        noiseGate.setReferenceEngine (useReferenceEngine);
+
+        chain.prepare ({ TestSignals::sampleRate, (juce::uint32) blockSize, 1 });
+
+        auto buffer = TestSignals::createDecayingNotes ((int) (12.0 * TestSignals::sampleRate), noiseLevel);
+        juce::dsp::AudioBlock<float> block (buffer);
+
+        // Notes last 0.3 s of every 1.5 s, the tail is timed from 0.5 s on when only the filter states ring
+        const int period = (int) (1.5 * TestSignals::sampleRate);
+        const int noteLength = (int) (0.3 * TestSignals::sampleRate), tailStart = (int) (0.5 * TestSignals::sampleRate);
+
+        DecayResult result;
+        juce::int64 noteTicks = 0, tailTicks = 0;
+        int numNoteSamples = 0, numTailSamples = 0;
+
+        for (int offset = 0; offset < buffer.getNumSamples(); offset += blockSize)
+        {
+            auto length = juce::jmin (blockSize, buffer.getNumSamples() - offset);
+            auto subBlock = block.getSubBlock ((size_t) offset, (size_t) length);
+
+            auto start = juce::Time::getHighResolutionTicks();
+            chain.process (juce::dsp::ProcessContextReplacing<float> (subBlock));
+            auto ticks = juce::Time::getHighResolutionTicks() - start;
+
+            auto position = offset % period;
+
+            if (position < noteLength)
+            {
+                noteTicks += ticks;
+                numNoteSamples += length;
+            }
+            else if (position >= tailStart)
+            {
+                tailTicks += ticks;
+                numTailSamples += length;
+            }
+
+            for (int i = 0; i < length; i++)
+                if (std::fpclassify (subBlock.getSample (0, i)) == FP_SUBNORMAL)
+                    result.numSubnormals++;
+        }
+
+        auto nanosecondsPerTick = 1.0e9 / (double) juce::Time::getHighResolutionTicksPerSecond();
+
+        result.noteNanosecondsPerSample = (double) noteTicks * nanosecondsPerTick / juce::jmax (1, numNoteSamples);
+        result.tailNanosecondsPerSample = (double) tailTicks * nanosecondsPerTick / juce::jmax (1, numTailSamples);
+
+        return result;
+    }
+}
+
+//==============================================================================
+class DenormalTests  : public juce::UnitTest
+{
+public:
+    DenormalTests() : juce::UnitTest ("Denormals", "Regression") {}
+
+    void runTest() override
+    {
+        juce::FloatVectorOperations::disableDenormalisedNumberSupport (false);
+
+        for (auto useReferenceEngine : { false, true })
+        {
+            beginTest (juce::String (useReferenceEngine ? "Reference" : "Fast") + " engine, note tails");
+
+            expectEquals (renderDecayingNotes (useReferenceEngine, false).numSubnormals, 0, "Subnormal output samples");
+
+            beginTest (juce::String (useReferenceEngine ? "Reference" : "Fast") + " engine, note tails over a -120 dB noise floor");
+
+            auto noiseLevel = juce::Decibels::decibelsToGain (-120.f, -200.f);
+            expectEquals (renderDecayingNotes (useReferenceEngine, false, noiseLevel).numSubnormals, 0, "Subnormal output samples");
+        }
+    }
+};
+
+static DenormalTests denormalTests;
+
+//==============================================================================
+/*
+    Processing time of the note tails with denormals enabled, against the same
+    tails with the hardware flushing them to zero. Subnormal filter states used
+    to make the tails several times slower.
+*/
+class DecayingSignalBenchmark  : public juce::UnitTest
+{
+public:
+    DecayingSignalBenchmark() : juce::UnitTest ("Decaying signals", "Benchmark") {}
+
+    void runTest() override
+    {
+        juce::FloatVectorOperations::disableDenormalisedNumberSupport (false);
+
+        for (auto useReferenceEngine : { false, true })
+        {
+            beginTest (juce::String (useReferenceEngine ? "Reference" : "Fast") + " engine");
+
+            auto result = renderDecayingNotes (useReferenceEngine, false);
+            auto flushed = renderDecayingNotes (useReferenceEngine, true);
+
+            logMessage ("notes " + juce::String (result.noteNanosecondsPerSample, 1) + " ns/sample, tails "
+                        + juce::String (result.tailNanosecondsPerSample, 1) + " ns/sample, tails flushed by the hardware "
+                        + juce::String (flushed.tailNanosecondsPerSample, 1) + " ns/sample");
+
+            expect (result.tailNanosecondsPerSample < maxSlowdown * flushed.tailNanosecondsPerSample,
+                    "The tails are slower with denormals enabled");
+        }
+    }
+
+private:
+    static constexpr double maxSlowdown = 1.5;
+};
+
+static DecayingSignalBenchmark decayingSignalBenchmark;
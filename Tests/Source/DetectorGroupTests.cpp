@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    DetectorGroupTests.cpp
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+//==============================================================================
+/*
+    A subscriber of a detector group gets one envelope per host block and runs
+    the chain in sub-blocks. The envelope has to ramp over the whole host block,
+    not over the first sub-block.
+*/
+class DetectorGroupTests  : public juce::UnitTest
+{
+public:
+    DetectorGroupTests() : juce::UnitTest ("Detector groups", "Regression") {}
+
+    void runTest() override
+    {
+        for (auto useReferenceEngine : { false, true })
+        {
+            auto engineName = juce::String (useReferenceEngine ? "reference" : "fast") + " engine";
+
+            beginTest ("External envelope ramp / buzz, " + engineName);
+            {
+                BuzzGate<float> gate;
+                checkRamp (gate, useReferenceEngine);
+            }
+
+            beginTest ("External envelope ramp / hiss, " + engineName);
+            {
+                HissGate<float> gate;
+                checkRamp (gate, useReferenceEngine);
+            }
+
+            beginTest ("External envelope ramp / noise, " + engineName);
+            {
+                NoiseReduction<float> gate;
+                checkRamp (gate, useReferenceEngine);
+            }
+        }
+    }
+
+private:
+    static constexpr int subBlockSize = 32, hostBlockSize = 512;
+
+    template <typename Stage>
+    void checkRamp (Stage& gate, bool useReferenceEngine)
+    {
+        gate.setReferenceEngine (useReferenceEngine);
+        gate.prepare ({ TestSignals::sampleRate, (juce::uint32) subBlockSize, 1 });
+
+        juce::AudioBuffer<float> buffer (1, subBlockSize);
+        juce::dsp::AudioBlock<float> block (buffer);
+
+        // Two host blocks, the second ramps back down from where the first one ended
+        for (auto target : { 0.1f, 0.02f })
+        {
+            auto start = gate.getEnvelope (0);
+            gate.setExternalEnvelope (0, target, hostBlockSize);
+
+            for (int offset = subBlockSize; offset <= hostBlockSize; offset += subBlockSize)
+            {
+                buffer.clear();
+                gate.process (juce::dsp::ProcessContextReplacing<float> (block));
+
+                auto expected = start + (target - start) * (float) offset / (float) hostBlockSize;
+                expectWithinAbsoluteError (gate.getEnvelope (0), expected, 1.0e-6f);
+            }
+        }
+
+        gate.clearExternalEnvelope();
+    }
+};
+
+static DetectorGroupTests detectorGroupTests;
@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    EngineTests.cpp
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+//==============================================================================
+/*
+    Checks that need no golden files: the fast engine stays close to the
+    reference engine, and the output does not depend on the host block size.
+*/
+class EngineTests  : public juce::UnitTest
+{
+public:
+    EngineTests() : juce::UnitTest ("Engines", "Regression") {}
+
+    void runTest() override
+    {
+        for (const auto& signal : TestSignals::createAll())
+        {
+            beginTest ("Fast against reference engine / " + signal.name);
+
+            if (auto maxResidualDecibels = getMaxEngineResidualDecibels (signal.name); maxResidualDecibels < 0)
+            {
+                PurristAudioProcessor fast, reference;
+                TestHelpers::setParameter (reference, "dsp_engine", 1.f);
+
+                auto difference = TestHelpers::compare (TestHelpers::renderProcessor (fast, signal.buffer),
+                                                        TestHelpers::renderProcessor (reference, signal.buffer));
+
+                expect (difference.residualDecibels < maxResidualDecibels,
+                        "Residual " + juce::String (difference.residualDecibels, 1) + " dB");
+            }
+
+            beginTest ("Host block size / " + signal.name);
+            {
+                PurristAudioProcessor processor;
+                auto expected = TestHelpers::renderProcessor (processor, signal.buffer, { 512 });
+
+                for (auto blockSizes : { std::initializer_list<int> { 32 },
+                                         std::initializer_list<int> { 100 },
+                                         std::initializer_list<int> { 1, 17, 480, 64, 2048 } })
+                {
+                    PurristAudioProcessor other;
+                    auto difference = TestHelpers::compare (TestHelpers::renderProcessor (other, signal.buffer, blockSizes), expected);
+
+                    expect (difference.maxSampleError <= 1.0e-6,
+                            "Sample error " + juce::String (difference.maxSampleError, 9));
+                }
+            }
+        }
+    }
+
+private:
+    /** The fast engine approximates the gain law and decides the gain once per
+        16 sample interval, so it lags the reference engine on hard onsets. A
+        lone impulse is all onset, those are left to the golden files (0 dB).
+    */
+    static double getMaxEngineResidualDecibels (const juce::String& signalName)
+    {
+        if (signalName == "impulses")
+            return 0.0;
+
+        return signalName == "noise_bursts" ? -20.0 : -35.0;
+    }
+};
+
+static EngineTests engineTests;
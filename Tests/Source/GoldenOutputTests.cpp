@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    GoldenOutputTests.cpp
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+//==============================================================================
+/*
+    Renders the test signals through every stage on its own and through the
+    whole plugin, and compares the output with the golden files. A missing
+    golden file fails the test, --record writes them all from the current output.
+*/
+class GoldenOutputTests  : public juce::UnitTest
+{
+public:
+    GoldenOutputTests() : juce::UnitTest ("Golden output", "Regression") {}
+
+    void runTest() override
+    {
+        auto signals = TestSignals::createAll();
+        auto noiseFloor = TestSignals::createNoiseBursts();
+
+        for (const auto& signal : signals)
+        {
+            const auto& input = signal.buffer;
+
+            {
+                BuzzGate<float> gate;
+                setUpBuzzGate (gate);
+                check ("buzz", signal.name, TestHelpers::renderStage (gate, input));
+            }
+            {
+                BuzzGate<float> gate;
+                setUpBuzzGate (gate);
+                gate.setMultirate (true);
+                check ("buzz_multirate", signal.name, TestHelpers::renderStage (gate, input));
+            }
+            {
+                HissGate<float> gate;
+                setUpHissGate (gate);
+                check ("hiss", signal.name, TestHelpers::renderStage (gate, input));
+            }
+            {
+                HissGate<float> gate;
+                setUpHissGate (gate);
+                gate.setOversampling (1);
+                check ("hiss_oversampled", signal.name, TestHelpers::renderStage (gate, input));
+            }
+            {
+                NoiseReduction<float> gate;
+                setUpNoiseReduction (gate);
+                check ("noise", signal.name, TestHelpers::renderStage (gate, input));
+            }
+            {
+                NoiseReduction<float> gate;
+                setUpNoiseReduction (gate);
+                gate.setMultiband (true);
+                check ("noise_multiband", signal.name, TestHelpers::renderStage (gate, input));
+            }
+            {
+                check ("spectral", signal.name, renderSpectralGate (input, noiseFloor));
+            }
+            {
+                PurristAudioProcessor processor;
+                check ("chain", signal.name, TestHelpers::renderProcessor (processor, input));
+            }
+            {
+                PurristAudioProcessor processor;
+                TestHelpers::setParameter (processor, "dsp_engine", 1.f);
+                check ("chain_reference", signal.name, TestHelpers::renderProcessor (processor, input));
+            }
+        }
+    }
+
+private:
+    // The stage settings match the parameter defaults and prepareToPlay()
+    static void setUpBuzzGate (BuzzGate<float>& gate)
+    {
+        gate.setThreshold (-42.f);
+        gate.setRatio (2.f);
+        gate.setAttack (50.f);
+        gate.setRelease (150.f);
+        gate.setFrequencyID (0);
+    }
+
+    static void setUpHissGate (HissGate<float>& gate)
+    {
+        gate.setThreshold (-48.f);
+        gate.setRatio (2.f);
+        gate.setCutoff (2000.f);
+        gate.setAttack (50.f);
+        gate.setRelease (300.f);
+    }
+
+    static void setUpNoiseReduction (NoiseReduction<float>& gate)
+    {
+        gate.setThreshold (-54.f);
+        gate.setRatio (3.f);
+        gate.setAttack (30.f);
+        gate.setRelease (200.f);
+    }
+
+    /** Learns the noise floor of the noise bursts signal first, then renders the input. */
+    static juce::AudioBuffer<float> renderSpectralGate (const juce::AudioBuffer<float>& input, const juce::AudioBuffer<float>& noiseFloor)
+    {
+        SpectralGate<float> gate;
+        gate.setReduction (18.f);
+
+        // The second half of each period of the bursts is noise floor only
+        const int learnStart = 6000, learnLength = 6000;
+        juce::AudioBuffer<float> noise (1, learnLength);
+        noise.copyFrom (0, 0, noiseFloor, 0, learnStart, learnLength);
+
+        gate.setLearning (true);
+        TestHelpers::renderStage (gate, noise);
+        gate.setLearning (false);
+
+        juce::AudioBuffer<float> output (input);
+        juce::dsp::AudioBlock<float> block (output);
+        gate.process (juce::dsp::ProcessContextReplacing<float> (block));
+
+        return output;
+    }
+
+    void check (const juce::String& stageName, const juce::String& signalName, const juce::AudioBuffer<float>& output)
+    {
+        const auto& options = TestOptions::get();
+        auto name = stageName + "_" + signalName;
+        auto file = options.goldenDirectory.getChildFile (name + ".wav");
+
+        beginTest (stageName + " / " + signalName);
+
+        if (options.shouldRecord)
+        {
+            expect (TestHelpers::writeGoldenFile (file, output), "Can't write " + file.getFullPathName());
+            logMessage ("Recorded " + file.getFileName());
+            return;
+        }
+
+        if (! file.existsAsFile())
+        {
+            expect (false, "Missing " + file.getFullPathName() + ", --record writes it");
+            return;
+        }
+
+        juce::AudioBuffer<float> golden;
+
+        if (! TestHelpers::readGoldenFile (file, golden))
+        {
+            expect (false, "Can't read " + file.getFullPathName());
+            return;
+        }
+
+        expectEquals (output.getNumSamples(), golden.getNumSamples(), name + " length");
+
+        auto difference = TestHelpers::compare (output, golden);
+
+        expect (difference.residualDecibels <= options.toleranceDecibels,
+                name + " residual " + juce::String (difference.residualDecibels, 1) + " dB");
+        expect (difference.maxSampleError <= options.maxSampleError,
+                name + " sample error " + juce::String (difference.maxSampleError, 7));
+    }
+};
+
+static GoldenOutputTests goldenOutputTests;
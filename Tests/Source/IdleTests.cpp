@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    IdleTests.cpp
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+//==============================================================================
+/*
+    The idle detectors against a processor that never skips its chain: a
+    subscriber of a detector group without a publisher runs its own detectors
+    but can't go idle. The input plays, fades to a noise floor far below the
+    thresholds and plays again at a sample off the 32 sample grid.
+*/
+namespace
+{
+    constexpr int quietStart = (int) (0.3 * TestSignals::sampleRate);
+    constexpr int wakeSample = (int) (1.2 * TestSignals::sampleRate) + 7;
+
+    juce::AudioBuffer<float> createIdleSignal()
+    {
+        juce::AudioBuffer<float> buffer (1, TestSignals::numSamples);
+        auto* samples = buffer.getWritePointer (0);
+        juce::Random random (31);
+
+        for (int i = 0; i < buffer.getNumSamples(); i++)
+        {
+            auto noise = 2.f * random.nextFloat() - 1.f;
+
+            if (i < quietStart)
+                samples[i] = 0.2f * noise;
+            else if (i < wakeSample)
+                samples[i] = 0.0001f * noise;
+            else
+                samples[i] = 0.3f * std::exp (-(float) (i - wakeSample) / 4800.f)
+                           * std::sin (juce::MathConstants<float>::twoPi * 1000.f * (float) (i - wakeSample) / (float) TestSignals::sampleRate);
+        }
+
+        // The burst starts on a peak, so its first sample wakes the chain
+        samples[wakeSample] = 0.3f;
+        return buffer;
+    }
+
+    juce::AudioBuffer<float> getRange (const juce::AudioBuffer<float>& buffer, int start, int end)
+    {
+        juce::AudioBuffer<float> range (1, end - start);
+        range.copyFrom (0, 0, buffer, 0, start, end - start);
+        return range;
+    }
+}
+
+//==============================================================================
+class IdleTests  : public juce::UnitTest
+{
+public:
+    IdleTests() : juce::UnitTest ("Idle detector", "Regression") {}
+
+    void runTest() override
+    {
+        auto input = createIdleSignal();
+
+        PurristAudioProcessor processor, reference;
+        TestHelpers::setParameter (reference, "group_id", 1.f);
+
+        auto output = TestHelpers::renderProcessor (processor, input);
+        auto expected = TestHelpers::renderProcessor (reference, input);
+
+        beginTest ("Silent once the chain has settled");
+        {
+            // Hold time of the default settings, 550 ms, and the fade
+            auto idleStart = quietStart + (int) (0.6 * TestSignals::sampleRate);
+            auto idleOutput = getRange (output, idleStart, wakeSample);
+
+            expectEquals (idleOutput.getMagnitude (0, 0, idleOutput.getNumSamples()), 0.f);
+            expect (juce::Decibels::gainToDecibels (expected.getMagnitude (0, idleStart, wakeSample - idleStart)) < -90.f,
+                    "The chain output is audible");
+        }
+
+        beginTest ("Wakes on the first sample above the threshold");
+        {
+            expect (output.getSample (0, wakeSample - 1) == 0.f, "Woke before the burst");
+            expect (output.getSample (0, wakeSample) != 0.f, "Still idle on the burst");
+
+            auto difference = TestHelpers::compare (getRange (output, wakeSample, output.getNumSamples()),
+                                                    getRange (expected, wakeSample, expected.getNumSamples()));
+
+            expect (difference.residualDecibels < -60.0, "Residual " + juce::String (difference.residualDecibels, 1) + " dB");
+        }
+
+        beginTest ("Host block size");
+        {
+            for (auto blockSizes : { std::initializer_list<int> { 32 },
+                                     std::initializer_list<int> { 1, 17, 480, 64, 2048 } })
+            {
+                PurristAudioProcessor other;
+                auto difference = TestHelpers::compare (TestHelpers::renderProcessor (other, input, blockSizes), output);
+
+                expect (difference.maxSampleError <= 1.0e-6,
+                        "Sample error " + juce::String (difference.maxSampleError, 9));
+            }
+        }
+    }
+};
+
+static IdleTests idleTests;
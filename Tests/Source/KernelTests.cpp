@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+    KernelTests.cpp
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+//==============================================================================
+/*
+    The SIMD kernels of the SVF cascade against the scalar one, on the hum
+    filters of the buzz gate with blocks of every length up to a control
+    interval, so the wavefront starts and drains inside and across blocks.
+*/
+namespace
+{
+    template <int numStages>
+    void designHumFilters (SVFCascade<float, numStages>& cascade, SVFKernels::Variant variant)
+    {
+        cascade.setKernelVariant (variant);
+
+        for (int stage = 0; stage < numStages; ++stage)
+            cascade.setStage (stage, TestSignals::sampleRate, 50.f * (float) (stage + 1), 75.f);
+    }
+
+    /** Noise and gains that sweep down and back up. */
+    struct PeakInput
+    {
+        explicit PeakInput (int numSamples) : samples ((size_t) numSamples), gains ((size_t) numSamples)
+        {
+            juce::Random random (0x5eed);
+
+            for (size_t i = 0; i < samples.size(); ++i)
+            {
+                samples[i] = random.nextFloat() * 2.f - 1.f;
+                gains[i] = 0.5f + 0.5f * std::cos (juce::MathConstants<float>::twoPi * (float) i / 4800.f);
+            }
+        }
+
+        std::vector<float> samples, gains;
+    };
+
+    /** Runs the input through the peak filters in place, the block sizes repeat. */
+    template <int numStages>
+    void processPeaks (SVFCascade<float, numStages>& cascade, PeakInput& input, const std::vector<size_t>& blockSizes)
+    {
+        auto& samples = input.samples;
+
+        for (size_t start = 0, block = 0; start < samples.size(); ++block)
+        {
+            auto length = juce::jmin (blockSizes[block % blockSizes.size()], samples.size() - start);
+            cascade.processPeak (0, samples.data() + start, input.gains.data() + start, length);
+            start += length;
+        }
+    }
+
+    template <int numStages>
+    std::vector<float> renderPeaks (SVFKernels::Variant variant, int numSamples, const std::vector<size_t>& blockSizes)
+    {
+        SVFCascade<float, numStages> cascade;
+        designHumFilters (cascade, variant);
+
+        PeakInput input (numSamples);
+        processPeaks (cascade, input, blockSizes);
+
+        return input.samples;
+    }
+
+    const std::vector<SVFKernels::Variant> simdVariants { SVFKernels::Variant::sse2, SVFKernels::Variant::avx2 };
+}
+
+//==============================================================================
+class KernelTests  : public juce::UnitTest
+{
+public:
+    KernelTests() : juce::UnitTest ("SVF kernels", "Regression") {}
+
+    void runTest() override
+    {
+        const std::vector<size_t> blockSizes { 16, 1, 5, 16, 7, 3, 16, 2, 11 };
+
+        for (auto variant : simdVariants)
+        {
+            if (SVFKernels::getPeakFunction (variant) == nullptr)
+                continue;
+
+            beginTest (juce::String (SVFKernels::getVariantName (variant)) + " / 6 stages");
+            expectEqualOutput (renderPeaks<6> (variant, 48000, blockSizes), renderPeaks<6> (SVFKernels::Variant::scalar, 48000, blockSizes));
+
+            beginTest (juce::String (SVFKernels::getVariantName (variant)) + " / 3 stages");
+            expectEqualOutput (renderPeaks<3> (variant, 48000, blockSizes), renderPeaks<3> (SVFKernels::Variant::scalar, 48000, blockSizes));
+        }
+    }
+
+private:
+    void expectEqualOutput (const std::vector<float>& output, const std::vector<float>& expected)
+    {
+        float maxError = 0;
+
+        for (size_t i = 0; i < output.size(); ++i)
+            maxError = juce::jmax (maxError, std::abs (output[i] - expected[i]));
+
+        expect (maxError <= 1.0e-6f, "Sample error " + juce::String (maxError, 9));
+    }
+};
+
+static KernelTests kernelTests;
+
+//==============================================================================
+/*
+    Time of the buzz gate's hum filters per variant, in the 16 sample control
+    intervals the fast engine runs them in.
+*/
+class KernelBenchmark  : public juce::UnitTest
+{
+public:
+    KernelBenchmark() : juce::UnitTest ("SVF kernels", "Benchmark") {}
+
+    void runTest() override
+    {
+        beginTest ("Hum filters, 6 stages");
+
+        const auto numSamples = (int) (10.0 * TestSignals::sampleRate);
+        const std::vector<size_t> blockSizes { SquareLawDetector<float>::controlInterval };
+        const auto bestVariant = SVFKernels::getBestVariant();
+
+        auto time = [&] (SVFKernels::Variant variant)
+        {
+            SVFCascade<float, 6> cascade;
+            designHumFilters (cascade, variant);
+            PeakInput input (numSamples);
+
+            auto start = juce::Time::getHighResolutionTicks();
+            processPeaks (cascade, input, blockSizes);
+            auto ticks = juce::Time::getHighResolutionTicks() - start;
+
+            return (double) ticks * 1.0e9 / (double) juce::Time::getHighResolutionTicksPerSecond() / (double) numSamples;
+        };
+
+        auto scalarTime = time (SVFKernels::Variant::scalar);
+        logMessage (juce::String ("scalar ") + juce::String (scalarTime, 2) + " ns/sample");
+
+        for (auto variant : simdVariants)
+        {
+            if (SVFKernels::getPeakFunction (variant) == nullptr)
+                continue;
+
+            auto variantTime = time (variant);
+            logMessage (juce::String (SVFKernels::getVariantName (variant)) + " " + juce::String (variantTime, 2) + " ns/sample, "
+                        + juce::String (scalarTime / variantTime, 2) + "x");
+
+            if (variant == bestVariant)
+                expect (variantTime < scalarTime, "The selected variant is slower than the scalar one");
+        }
+    }
+};
+
+static KernelBenchmark kernelBenchmark;
@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+//==============================================================================
+/*
+    PurristTests [options]
+
+    --record                Rewrites all golden files from the current output
+    --golden=<directory>    Golden file directory, Tests/golden by default
+    --tolerance-db=<dB>     Largest residual against a golden file (-80)
+    --max-error=<value>     Largest single sample error against a golden file (1e-4)
+    --category=<name>       Test category to run, "Regression" by default
+    --benchmark             Runs the benchmarks instead of the regression tests
+    --deadline=<fraction>   Block load the benchmarks report as late (0.5)
+*/
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList arguments (argc, argv);
+    auto& options = TestOptions::get();
+
+    options.shouldRecord = arguments.containsOption ("--record");
+    options.goldenDirectory = juce::File (PURRIST_GOLDEN_DIRECTORY);
+
+    if (arguments.containsOption ("--golden"))
+        options.goldenDirectory = juce::File::getCurrentWorkingDirectory().getChildFile (arguments.getValueForOption ("--golden"));
+
+    if (arguments.containsOption ("--tolerance-db"))
+        options.toleranceDecibels = arguments.getValueForOption ("--tolerance-db").getDoubleValue();
+
+    if (arguments.containsOption ("--max-error"))
+        options.maxSampleError = arguments.getValueForOption ("--max-error").getDoubleValue();
+
+    if (arguments.containsOption ("--deadline"))
+        options.deadlineFraction = arguments.getValueForOption ("--deadline").getDoubleValue();
+
+    juce::String category ("Regression");
+
+    if (arguments.containsOption ("--benchmark"))
+        category = "Benchmark";
+
+    if (arguments.containsOption ("--category"))
+        category = arguments.getValueForOption ("--category");
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+    runner.runTestsInCategory (category);
+
+    int numFailures = 0;
+
+    for (int i = 0; i < runner.getNumResults(); i++)
+        numFailures += runner.getResult (i)->failures;
+
+    return numFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    RealtimeAuditTests.cpp
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+#include "modules/diagnostics/RealtimeAudit.h"
+
+//==============================================================================
+/*
+    Sweeps every parameter of the plugin through its range while audio runs,
+    with changing host block sizes, and fails on any allocation or lock the
+    realtime audit catches inside processBlock, or on a latency change, which
+    only the message thread may report. Needs PURRIST_REALTIME_AUDIT, which the
+    CMake target turns on by default on Linux.
+*/
+class RealtimeAuditTests  : public juce::UnitTest
+{
+public:
+    RealtimeAuditTests() : juce::UnitTest ("Realtime audit", "Regression") {}
+
+    void runTest() override
+    {
+        beginTest ("Parameter sweeps");
+
+       #if PURRIST_REALTIME_AUDIT
+        PurristAudioProcessor processor;
+        TestHelpers::prepareProcessor (processor, maxBlockSize);
+
+        // Timing takes its own path through processBlock
+        processor.getStageTimers().setEnabled (true);
+
+        auto input = TestSignals::createHumAndPlucks();
+        juce::AudioBuffer<float> buffer (2, maxBlockSize);
+        juce::MidiBuffer midi;
+        int position = 0, blockIndex = 0;
+
+        auto processBlocks = [&] (int numBlocks)
+        {
+            for (int i = 0; i < numBlocks; i++)
+            {
+                auto length = blockSizes[(size_t) blockIndex++ % blockSizes.size()];
+
+                if (position + length > input.getNumSamples())
+                    position = 0;
+
+                buffer.setSize (2, length, false, false, true);
+
+                for (int channel = 0; channel < 2; channel++)
+                    buffer.copyFrom (channel, 0, input, 0, position, length);
+
+                processor.processBlock (buffer, midi);
+                position += length;
+            }
+        };
+
+        // Let the first blocks settle everything that is set up lazily
+        processBlocks (8);
+        RealtimeAudit::resetViolations();
+
+        const auto latency = processor.getLatencySamples();
+
+        for (auto* parameter : processor.getParameters())
+        {
+            auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (parameter);
+
+            if (ranged == nullptr)
+                continue;
+
+            auto defaultValue = ranged->getDefaultValue();
+
+            for (int step = 0; step <= numSteps; step++)
+            {
+                ranged->setValueNotifyingHost ((float) step / (float) numSteps);
+                processBlocks (3);
+
+                expectEquals (processor.getLatencySamples(), latency, ranged->getParameterID() + " latency");
+            }
+
+            ranged->setValueNotifyingHost (defaultValue);
+            processBlocks (3);
+
+            expectEquals (RealtimeAudit::getNumViolations(), 0, ranged->getParameterID());
+            RealtimeAudit::resetViolations();
+        }
+
+        beginTest ("Noise profile learning");
+
+        processor.setSpectralLearning (true);
+        processBlocks (16);
+        processor.setSpectralLearning (false);
+        processBlocks (16);
+
+        expectEquals (RealtimeAudit::getNumViolations(), 0);
+       #else
+        logMessage ("Built without PURRIST_REALTIME_AUDIT, skipped");
+       #endif
+    }
+
+private:
+    static constexpr int numSteps = 12, maxBlockSize = 1024;
+    const std::vector<int> blockSizes { 256, 17, 1024, 64, 1, 480 };
+};
+
+static RealtimeAuditTests realtimeAuditTests;
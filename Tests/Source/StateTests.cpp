@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    StateTests.cpp
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+//==============================================================================
+/*
+    The binary plugin state with its noise profiles, states of the first
+    binary version and the A/B slots. A loaded state replaces everything the
+    processor held before, including noise profiles the state doesn't have.
+*/
+class StateTests  : public juce::UnitTest
+{
+public:
+    StateTests() : juce::UnitTest ("Plugin state", "Regression") {}
+
+    void runTest() override
+    {
+        beginTest ("Round trip");
+        {
+            PurristAudioProcessor source, destination;
+            TestHelpers::setParameter (source, "buzz_threshold", -30.f);
+            setProfile (source, 1, 2.f);
+
+            juce::MemoryBlock state;
+            source.getStateInformation (state);
+            destination.setStateInformation (state.getData(), (int) state.getSize());
+
+            expectEquals (destination.apvts.getRawParameterValue ("buzz_threshold")->load(), -30.f);
+            expect (! getSpectralGate (destination, 0).hasNoiseProfile(), "Channel 0 has a profile");
+            expectProfile (destination, 1, 2.f);
+        }
+
+        beginTest ("A state without profiles clears the loaded ones");
+        {
+            PurristAudioProcessor source, destination;
+            setProfile (destination, 0, 1.f);
+            setProfile (destination, 1, 1.f);
+
+            juce::MemoryBlock state;
+            source.getStateInformation (state);
+            destination.setStateInformation (state.getData(), (int) state.getSize());
+
+            for (int channel = 0; channel < 2; channel++)
+                expect (! getSpectralGate (destination, channel).hasNoiseProfile(), "Channel " + juce::String (channel) + " kept its profile");
+        }
+
+        beginTest ("Version 1");
+        {
+            PurristAudioProcessor source, destination;
+            TestHelpers::setParameter (source, "hiss_cutoff", 3000.f);
+            setProfile (source, 0, 3.f);
+            setProfile (source, 1, 4.f);
+
+            juce::MemoryBlock state;
+            source.getStateInformation (state);
+
+            // Version 1 has no number of profiles after the parameter block
+            auto profilesOffset = (size_t) PresetManager::stateHeaderSize + sizeof (float) * PresetManager::numParameters;
+            auto* bytes = static_cast<const char*> (state.getData());
+
+            juce::MemoryBlock versionOne;
+            juce::MemoryOutputStream stream (versionOne, false);
+            stream.writeInt ((int) PresetManager::stateMagic);
+            stream.writeInt (1);
+            stream.write (bytes + 2 * sizeof (juce::uint32), profilesOffset - 2 * sizeof (juce::uint32));
+            stream.write (bytes + profilesOffset + sizeof (int), state.getSize() - profilesOffset - sizeof (int));
+
+            destination.setStateInformation (versionOne.getData(), (int) versionOne.getSize());
+
+            expectEquals (destination.apvts.getRawParameterValue ("hiss_cutoff")->load(), 3000.f);
+            expectProfile (destination, 0, 3.f);
+            expectProfile (destination, 1, 4.f);
+        }
+
+        beginTest ("A/B copy");
+        {
+            PurristAudioProcessor processor;
+            auto& presetManager = processor.getPresetManager();
+
+            TestHelpers::setParameter (processor, "noise_ratio", 6.f);
+            presetManager.copyToOtherSlot();
+            TestHelpers::setParameter (processor, "noise_ratio", 2.f);
+            presetManager.switchToSlot (PresetManager::slotB);
+
+            expectEquals (processor.apvts.getRawParameterValue ("noise_ratio")->load(), 6.f);
+        }
+
+        beginTest ("A/B slots round trip");
+        {
+            PurristAudioProcessor source, destination;
+            auto& sourceSlots = source.getPresetManager();
+
+            TestHelpers::setParameter (source, "noise_ratio", 6.f);
+            sourceSlots.switchToSlot (PresetManager::slotB);
+            TestHelpers::setParameter (source, "noise_ratio", 2.f);
+
+            juce::MemoryBlock state;
+            source.getStateInformation (state);
+            destination.setStateInformation (state.getData(), (int) state.getSize());
+
+            auto& destinationSlots = destination.getPresetManager();
+            expect (destinationSlots.getActiveSlot() == PresetManager::slotB, "Slot B isn't active");
+            expectEquals (destination.apvts.getRawParameterValue ("noise_ratio")->load(), 2.f);
+
+            destinationSlots.switchToSlot (PresetManager::slotA);
+            expectEquals (destination.apvts.getRawParameterValue ("noise_ratio")->load(), 6.f);
+        }
+    }
+
+private:
+    static SpectralGate<float>& getSpectralGate (PurristAudioProcessor& processor, int channel)
+    {
+        return processor.chain[channel].get<ChainPositions::spectralGate>();
+    }
+
+    static void setProfile (PurristAudioProcessor& processor, int channel, float value)
+    {
+        std::vector<float> profile ((size_t) SpectralGate<float>::getNumBins(), value);
+        getSpectralGate (processor, channel).setNoiseProfile (profile.data());
+    }
+
+    void expectProfile (PurristAudioProcessor& processor, int channel, float value)
+    {
+        auto& spectralGate = getSpectralGate (processor, channel);
+        expect (spectralGate.hasNoiseProfile(), "Channel " + juce::String (channel) + " has no profile");
+
+        std::vector<float> profile ((size_t) SpectralGate<float>::getNumBins());
+        spectralGate.getNoiseProfile (profile.data());
+
+        expectEquals (profile.front(), value);
+        expectEquals (profile.back(), value);
+    }
+};
+
+static StateTests stateTests;
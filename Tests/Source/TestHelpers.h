@@ -0,0 +1,174 @@
+/*
+  ==============================================================================
+
+    TestHelpers.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "TestSignals.h"
+
+//==============================================================================
+/** Command line settings shared by all tests, filled in by main(). */
+struct TestOptions
+{
+    juce::File goldenDirectory;
+    bool shouldRecord = false;
+
+    /** Largest residual energy against a golden file, relative to the golden energy. */
+    double toleranceDecibels = -80.0;
+
+    /** Largest difference of a single sample against a golden file. */
+    double maxSampleError = 1.0e-4;
+
+    /** Share of the block length above which the benchmark reports a block as late. */
+    double deadlineFraction = 0.5;
+
+    static TestOptions& get()
+    {
+        static TestOptions options;
+        return options;
+    }
+};
+
+//==============================================================================
+namespace TestHelpers
+{
+    /** Renders a mono signal through one stage, in blocks of the given size. */
+    template <typename Stage>
+    juce::AudioBuffer<float> renderStage (Stage& stage, const juce::AudioBuffer<float>& input, int blockSize = 32)
+    {
+        stage.prepare ({ TestSignals::sampleRate, (juce::uint32) blockSize, 1 });
+
+        juce::AudioBuffer<float> output (input);
+        juce::dsp::AudioBlock<float> block (output);
+
+        for (int offset = 0; offset < output.getNumSamples(); offset += blockSize)
+        {
+            auto length = juce::jmin (blockSize, output.getNumSamples() - offset);
+            auto subBlock = block.getSubBlock ((size_t) offset, (size_t) length);
+
+            stage.process (juce::dsp::ProcessContextReplacing<float> (subBlock));
+        }
+
+        return output;
+    }
+
+    /** Sets a parameter of the processor to a plain (not normalised) value. */
+    inline void setParameter (PurristAudioProcessor& processor, const juce::String& parameterID, float value)
+    {
+        auto* parameter = processor.apvts.getParameter (parameterID);
+        jassert (parameter != nullptr);
+
+        parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    }
+
+    /** Prepares the processor like a host would. */
+    inline void prepareProcessor (PurristAudioProcessor& processor, int blockSize)
+    {
+        processor.setRateAndBufferSizeDetails (TestSignals::sampleRate, blockSize);
+        processor.prepareToPlay (TestSignals::sampleRate, blockSize);
+    }
+
+    /** Renders a mono signal through the plugin on both channels and returns the left one.
+        Host blocks cycle through the given sizes, the processor is prepared for the largest.
+    */
+    inline juce::AudioBuffer<float> renderProcessor (PurristAudioProcessor& processor, const juce::AudioBuffer<float>& input,
+                                                     std::initializer_list<int> blockSizes = { 512 })
+    {
+        auto maxBlockSize = std::max (blockSizes);
+        prepareProcessor (processor, maxBlockSize);
+
+        juce::AudioBuffer<float> buffer (2, maxBlockSize), output (1, input.getNumSamples());
+        juce::MidiBuffer midi;
+        auto blockSize = blockSizes.begin();
+
+        for (int offset = 0; offset < input.getNumSamples(); offset += buffer.getNumSamples())
+        {
+            auto length = juce::jmin (*blockSize, input.getNumSamples() - offset);
+
+            if (++blockSize == blockSizes.end())
+                blockSize = blockSizes.begin();
+
+            buffer.setSize (2, length, false, false, true);
+
+            for (int channel = 0; channel < 2; channel++)
+                buffer.copyFrom (channel, 0, input, 0, offset, length);
+
+            processor.processBlock (buffer, midi);
+            output.copyFrom (0, offset, buffer, 0, 0, length);
+        }
+
+        return output;
+    }
+
+    //==============================================================================
+    struct Difference
+    {
+        double residualDecibels = -300.0, maxSampleError = 0.0;
+    };
+
+    /** Energy of the difference relative to the energy of the reference, and the largest sample difference. */
+    inline Difference compare (const juce::AudioBuffer<float>& output, const juce::AudioBuffer<float>& reference)
+    {
+        Difference difference;
+        double residual = 0, energy = 0;
+        auto numSamples = juce::jmin (output.getNumSamples(), reference.getNumSamples());
+
+        for (int channel = 0; channel < juce::jmin (output.getNumChannels(), reference.getNumChannels()); channel++)
+        {
+            auto* samples = output.getReadPointer (channel);
+            auto* expected = reference.getReadPointer (channel);
+
+            for (int i = 0; i < numSamples; i++)
+            {
+                auto error = (double) samples[i] - (double) expected[i];
+
+                residual += error * error;
+                energy += (double) expected[i] * (double) expected[i];
+                difference.maxSampleError = juce::jmax (difference.maxSampleError, std::abs (error));
+            }
+        }
+
+        difference.residualDecibels = 10.0 * std::log10 (residual / juce::jmax (energy, 1.0e-30) + 1.0e-30);
+        return difference;
+    }
+
+    //==============================================================================
+    /** Golden files are 32 bit float WAVs, exact and still easy to listen to. */
+    inline bool writeGoldenFile (const juce::File& file, const juce::AudioBuffer<float>& buffer)
+    {
+        file.getParentDirectory().createDirectory();
+        file.deleteFile();
+
+        auto stream = file.createOutputStream();
+
+        if (stream == nullptr)
+            return false;
+
+        juce::WavAudioFormat format;
+        std::unique_ptr<juce::AudioFormatWriter> writer (format.createWriterFor (stream.get(), TestSignals::sampleRate,
+                                                                                 (unsigned int) buffer.getNumChannels(), 32, {}, 0));
+        if (writer == nullptr)
+            return false;
+
+        stream.release();
+        return writer->writeFromAudioSampleBuffer (buffer, 0, buffer.getNumSamples());
+    }
+
+    inline bool readGoldenFile (const juce::File& file, juce::AudioBuffer<float>& buffer)
+    {
+        juce::WavAudioFormat format;
+        std::unique_ptr<juce::AudioFormatReader> reader (format.createReaderFor (file.createInputStream().release(), true));
+
+        if (reader == nullptr)
+            return false;
+
+        buffer.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+        return reader->read (&buffer, 0, buffer.getNumSamples(), 0, true, true);
+    }
+}
@@ -0,0 +1,174 @@
+/*
+  ==============================================================================
+
+    TestSignals.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Deterministic mono test signals. Every generator seeds its own juce::Random,
+    so a signal is bit-identical on every run and platform and the golden files
+    stay valid.
+*/
+namespace TestSignals
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int numSamples = 72000;
+
+    struct Signal
+    {
+        juce::String name;
+        juce::AudioBuffer<float> buffer;
+    };
+
+    //==============================================================================
+    /** Exponential sweep from 20 Hz to 20 kHz, in three level steps from open to fully gated. */
+    inline juce::AudioBuffer<float> createSweep (int length = numSamples)
+    {
+        juce::AudioBuffer<float> buffer (1, length);
+        auto* samples = buffer.getWritePointer (0);
+
+        const double lowFrequency = 20.0, highFrequency = 20000.0;
+        const auto duration = length / sampleRate;
+        const auto rate = std::log (highFrequency / lowFrequency);
+        const float levels[] = { 0.25f, 0.016f, 0.001f };
+
+        for (int i = 0; i < length; i++)
+        {
+            auto time = i / sampleRate;
+            auto phase = juce::MathConstants<double>::twoPi * lowFrequency * duration / rate
+                       * (std::exp (time / duration * rate) - 1.0);
+
+            samples[i] = levels[i * 3 / length] * (float) std::sin (phase);
+        }
+
+        return buffer;
+    }
+
+    /** Mains hum with harmonics under decaying plucked notes and a faint noise floor. */
+    inline juce::AudioBuffer<float> createHumAndPlucks (int length = numSamples)
+    {
+        juce::AudioBuffer<float> buffer (1, length);
+        auto* samples = buffer.getWritePointer (0);
+        juce::Random random (37);
+
+        const double notes[] = { 82.41, 196.0, 146.83, 329.63 };
+        const int noteLength = (int) (0.375 * sampleRate);
+
+        for (int i = 0; i < length; i++)
+        {
+            auto time = i / sampleRate;
+            double hum = 0;
+
+            for (int harmonic = 1; harmonic <= 8; harmonic++)
+                hum += 0.003 / harmonic * std::sin (juce::MathConstants<double>::twoPi * 50.0 * harmonic * time);
+
+            auto note = notes[(i / noteLength) % 4];
+            auto noteTime = (i % noteLength) / sampleRate;
+            double pluck = 0;
+
+            for (int partial = 1; partial <= 6; partial++)
+                pluck += 0.3 / partial * std::exp (-(3.0 + 2.0 * partial) * noteTime)
+                       * std::sin (juce::MathConstants<double>::twoPi * note * partial * noteTime);
+
+            samples[i] = (float) (hum + pluck) + 0.0005f * (2.f * random.nextFloat() - 1.f);
+        }
+
+        return buffer;
+    }
+
+    /** Loud white noise bursts over a low noise floor. */
+    inline juce::AudioBuffer<float> createNoiseBursts (int length = numSamples)
+    {
+        juce::AudioBuffer<float> buffer (1, length);
+        auto* samples = buffer.getWritePointer (0);
+        juce::Random random (53);
+
+        const int period = (int) (0.25 * sampleRate), burstLength = (int) (0.08 * sampleRate);
+
+        for (int i = 0; i < length; i++)
+        {
+            auto level = i % period < burstLength ? 0.2f : 0.0003f;
+            samples[i] = level * (2.f * random.nextFloat() - 1.f);
+        }
+
+        return buffer;
+    }
+
+    /** Impulses of falling height in digital silence, a quarter of a second apart. */
+    inline juce::AudioBuffer<float> createImpulses (int length = numSamples)
+    {
+        juce::AudioBuffer<float> buffer (1, length);
+        buffer.clear();
+
+        const int period = (int) (0.25 * sampleRate);
+        float height = 0.9f;
+
+        for (int i = period / 8; i < length; i += period, height *= 0.5f)
+            buffer.setSample (0, i, height);
+
+        return buffer;
+    }
+
+    /** Plucked notes that die out into long stretches of digital silence, or of white
+        noise with the given peak level.
+    */
+    inline juce::AudioBuffer<float> createDecayingNotes (int length = numSamples, float noiseLevel = 0.f)
+    {
+        juce::AudioBuffer<float> buffer (1, length);
+        auto* samples = buffer.getWritePointer (0);
+        juce::Random random (71);
+
+        const int period = (int) (1.5 * sampleRate), noteLength = (int) (0.3 * sampleRate);
+
+        for (int i = 0; i < length; i++)
+        {
+            auto position = i % period;
+            auto time = position / sampleRate;
+
+            samples[i] = position < noteLength
+                       ? (float) (0.4 * std::exp (-12.0 * time) * std::sin (juce::MathConstants<double>::twoPi * 110.0 * time))
+                       : 0.f;
+
+            samples[i] += noiseLevel * (2.f * random.nextFloat() - 1.f);
+        }
+
+        return buffer;
+    }
+
+    /** All signals of the golden-output tests. */
+    inline std::vector<Signal> createAll()
+    {
+        std::vector<Signal> signals;
+        signals.push_back ({ "sweep", createSweep() });
+        signals.push_back ({ "hum_plucks", createHumAndPlucks() });
+        signals.push_back ({ "noise_bursts", createNoiseBursts() });
+        signals.push_back ({ "impulses", createImpulses() });
+        return signals;
+    }
+
+    /** A long mix of all the signals, for the benchmarks. */
+    inline juce::AudioBuffer<float> createSession (double seconds)
+    {
+        auto length = (int) (seconds * sampleRate);
+        juce::AudioBuffer<float> buffer (1, length);
+        auto signals = createAll();
+
+        for (int offset = 0, index = 0; offset < length; index++)
+        {
+            const auto& source = signals[(size_t) index % signals.size()].buffer;
+            auto count = juce::jmin (source.getNumSamples(), length - offset);
+
+            buffer.copyFrom (0, offset, source, 0, 0, count);
+            offset += count;
+        }
+
+        return buffer;
+    }
+}